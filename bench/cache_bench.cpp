@@ -0,0 +1,101 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <unistd.h>
+#include <cache.h>
+#include <sharded_cache.h>
+
+/**
+ *	Contention benchmark for the kernel column caches.
+ *
+ *	Every thread runs a fetch-or-insert loop over a shared key space that is
+ *	twice the cache capacity, with values the size of a short kernel column, so
+ *	both the hit path (lookup, touch, copy) and the miss path (insert, evict)
+ *	are exercised. LRUCache (one global mutex) and ShardedLRUCache are run at
+ *	1 to 64 threads and the aggregate throughput is printed.
+ */
+
+typedef std::vector< double > Column;
+
+static const unsigned long kCapacity = 4096;
+static const unsigned long kKeys = 2 * kCapacity;
+static const int kColumn = 64;
+
+/** \brief Small per-thread xorshift generator, so the benchmark does not contend on rand() */
+static inline unsigned long long next_key(unsigned long long &state)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state % kKeys;
+}
+
+template<class Cache>
+static double run(Cache &cache, int threads, long ops_per_thread, double *hit_rate)
+{
+	std::atomic<long> hits(0);
+	std::vector<std::thread> pool;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int t = 0; t < threads; t++)
+	{
+		pool.push_back(std::thread([&cache, &hits, t, ops_per_thread]()
+		{
+			unsigned long long state = 0x9E3779B97F4A7C15ULL * (t + 1);
+			Column column;
+			long local_hits = 0;
+
+			for (long op = 0; op < ops_per_thread; op++)
+			{
+				int key = (int) next_key(state);
+				if (cache.fetch(key, column))
+				{
+					++local_hits;
+				}
+				else
+				{
+					cache.insert(key, Column(kColumn, (double) key));
+				}
+			}
+			hits += local_hits;
+		}));
+	}
+	for (size_t t = 0; t < pool.size(); t++)
+	{
+		pool[t].join();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	*hit_rate = (double) hits / ((double) threads * ops_per_thread);
+	return (double) threads * ops_per_thread / seconds;
+}
+
+int main(int argc, char **argv)
+{
+	long ops = (argc > 1) ? strtol(argv[1], NULL, 10) : 200000;
+	int shards = (argc > 2) ? (int) strtol(argv[2], NULL, 10) : 64;
+	const int thread_counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+	printf("# %ld ops/thread, capacity %lu, %lu keys, %d doubles per value, %ld cpus\n",
+			ops, kCapacity, kKeys, kColumn, sysconf(_SC_NPROCESSORS_ONLN));
+	printf("%-8s %-10s %14s %8s\n", "threads", "cache", "ops/sec", "hits");
+
+	for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++)
+	{
+		int threads = thread_counts[i];
+		double hit_rate;
+
+		LRUCache<int, Column> global(kCapacity);
+		double rate = run(global, threads, ops, &hit_rate);
+		printf("%-8d %-10s %14.0f %7.1f%%\n", threads, "global", rate, 100 * hit_rate);
+
+		ShardedLRUCache<int, Column> sharded(kCapacity, shards);
+		rate = run(sharded, threads, ops, &hit_rate);
+		printf("%-8d %-10s %14.0f %7.1f%%\n", threads, "sharded", rate, 100 * hit_rate);
+	}
+
+	return 0;
+}
@@ -0,0 +1,31 @@
+#! /bin/bash
+#
+# Runs distributed training on one box: a coordinator plus separately started
+# worker processes, and compares the result with the serial solver.
+#
+# usage: bench/dist_local.sh [dataset] [workers] [unix|tcp]
+
+set -e
+
+cd "$(dirname "$0")/.."
+make svm_train > /dev/null
+
+data=${1:-src/test.input}
+workers=${2:-4}
+case "${3:-unix}" in
+	unix) address="unix:/tmp/mysvm_dist.$$.sock" ;;
+	tcp) address="tcp:127.0.0.1:$((20000 + $$ % 10000))" ;;
+	*) echo "transport must be unix or tcp" >&2; exit 1 ;;
+esac
+
+./model train -w "$workers" -a "$address" "$data" > /tmp/mysvm_dist.$$.out &
+coordinator=$!
+for i in $(seq "$workers"); do
+	./model -W "$address" &
+done
+wait $coordinator
+wait
+
+echo "serial:      $(./model train -e smo "$data" | grep '^trained in')"
+echo "distributed: $(grep '^trained in' /tmp/mysvm_dist.$$.out) [$(grep '^distributed' /tmp/mysvm_dist.$$.out)]"
+rm -f /tmp/mysvm_dist.$$.out
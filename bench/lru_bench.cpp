@@ -0,0 +1,112 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <chrono>
+#include <cache.h>
+#include <kernel_cache.h>
+
+/**
+ *	Kernel row cache benchmark: cache.h's LRUCache (std::map index, std::list
+ *	storage, one allocation per inserted row) against KernelCache and its
+ *	preallocated intrusive MySVM::LRUCache index and slab of columns. Both hold
+ *	the listed number of full rows.
+ *
+ *	Accesses follow a hot/cold pattern similar to SMO, where a small set of
+ *	non-bound rows is requested much more often than the rest: 80% of the
+ *	requests go to 20% of the rows. A miss "computes" the row with a memset,
+ *	so the numbers measure cache overhead rather than kernel evaluations.
+ */
+
+typedef std::vector<double> Row;
+
+static inline int next_row(unsigned long long &state, int length)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	int hot = length / 5 > 0 ? length / 5 : 1;
+	if (state % 10 < 8)
+	{
+		return (int) ((state >> 8) % hot);
+	}
+	return (int) ((state >> 8) % length);
+}
+
+static double bench_map_lru(int length, unsigned long rows, long ops, double *sink)
+{
+	LRUCache<int, Row> cache(rows);
+	unsigned long long state = 88172645463325252ULL;
+	double sum = 0;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (long op = 0; op < ops; op++)
+	{
+		int index = next_row(state, length);
+		Row *row = cache.fetch_ptr(index);
+		if (row == NULL)
+		{
+			Row fresh(length);
+			memset(&fresh[0], 0, length * sizeof(double));
+			fresh[index] = index;
+			cache.insert(index, fresh);
+			row = cache.fetch_ptr(index);
+		}
+		sum += (*row)[index];
+	}
+	*sink += sum;
+	return ops / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double bench_intrusive_lru(int length, unsigned long rows, long ops, double *sink, double *hit_rate)
+{
+	MySVM::KernelCache cache(length, rows * (sizeof(MySVM::KernelColumn) + length * sizeof(double)));
+	unsigned long long state = 88172645463325252ULL;
+	double sum = 0;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (long op = 0; op < ops; op++)
+	{
+		int index = next_row(state, length);
+		bool cached;
+		double *row = cache.column(index, &cached);
+		if (!cached)
+		{
+			memset(row, 0, length * sizeof(double));
+			row[index] = index;
+		}
+		sum += row[index];
+	}
+	*sink += sum;
+	*hit_rate = (double) cache.hits / ops;
+	return ops / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+	long ops = (argc > 1) ? strtol(argv[1], NULL, 10) : 2000000;
+	const int lengths[] = { 1000, 2000, 8000 };
+	const double fractions[] = { 0.05, 0.2, 0.5 };
+	double sink = 0;
+
+	printf("# %ld row requests per run at length 1000, scaled down for longer rows; 80%% of them to 20%% of the rows\n", ops);
+	printf("%-8s %-8s %8s %14s %14s %8s\n", "length", "rows", "hits", "map ops/s", "intrusive ops/s", "speedup");
+
+	for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+	{
+		for (size_t f = 0; f < sizeof(fractions) / sizeof(fractions[0]); f++)
+		{
+			int length = lengths[l];
+			unsigned long rows = (unsigned long) (length * fractions[f]);
+			long runs = ops / (length / 1000);
+			double hit_rate;
+
+			double map_rate = bench_map_lru(length, rows, runs, &sink);
+			double intrusive_rate = bench_intrusive_lru(length, rows, runs, &sink, &hit_rate);
+			printf("%-8d %-8lu %7.1f%% %14.0f %14.0f %7.2fx\n", length, rows, 100 * hit_rate,
+					map_rate, intrusive_rate, intrusive_rate / map_rate);
+		}
+	}
+
+	return sink == 42 ? 1 : 0;
+}
@@ -0,0 +1,52 @@
+#! /bin/bash
+#
+# Speedup of the parallel training modes over serial SMO training.
+#
+# usage: bench/smo_speedup.sh [-c partitions] [dataset] [thread counts...]
+#   -c runs the cascade with that many partitions (model train -c) instead of the
+#   parallel SMO loop (model train -t)
+#   without a dataset, a 20000 x 50 problem is generated with svm_gen
+#   thread counts default to 8 16 32; the baseline is always serial SMO (model train -e smo),
+#   and -t 1 is listed too, so the cost of the batching itself shows apart from the scaling
+
+set -e
+
+cd "$(dirname "$0")/.."
+make svm_train svm_gen > /dev/null
+
+mode=""
+if [ "$1" = "-c" ]; then
+	mode="-c $2"
+	shift 2
+fi
+
+data=${1:-}
+if [ -z "$data" ]; then
+	data=$(mktemp /tmp/smo_speedup.XXXXXX)
+	trap 'rm -f "$data"' EXIT
+	./svm_gen -n 20000 -m 50 -e 0.05 -s 0.3 -S 7 -b "$data"
+fi
+shift || true
+
+counts=${*:-"8 16 32"}
+base=""
+
+run() {
+	line=$(./model train "$@" "$data" | grep "^trained in")
+	secs=$(echo "$line" | sed -e 's/trained in \([0-9.]*\) s.*/\1/')
+	passes=$(echo "$line" | sed -e 's/.*(\([0-9]*\) passes.*/\1/')
+	obj=$(echo "$line" | sed -e 's/.*dual objective //')
+	if [ -z "$base" ]; then
+		base=$secs
+	fi
+	printf "%-8s %-6s %10s %8.2f %8s %18s\n" "$threads" "$label" "$secs" \
+		"$(awk -v a="$base" -v b="$secs" 'BEGIN { print a / b }')" "$passes" "$obj"
+}
+
+printf "%-8s %-6s %10s %8s %8s %18s\n" threads mode seconds speedup passes objective
+threads=1 label=serial run -e smo
+for threads in 1 $counts; do
+	label=${mode:+cascade}
+	label=${label:-smo}
+	run -t "$threads" $mode
+done
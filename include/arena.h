@@ -0,0 +1,66 @@
+/** @file arena.h
+ * @brief One block of memory carved into the fixed-size arrays of a solver
+ *
+ * The per-row and per-feature state of a solver is sized once by init(), so
+ * it is allocated as a single block that is released with its owner: there
+ * are no separate allocations to pair with frees, and the footprint of a job
+ * is known up front. The block can live on huge pages (see huge_pages.h).
+ */
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <huge_pages.h>
+
+namespace MySVM {
+
+class Arena {
+public:
+	Arena() : used_(0) {}
+
+	/** \brief Rounds bytes up to the alignment of every array handed out */
+	static size_t align(size_t bytes) { return (bytes + 63) & ~(size_t) 63; }
+
+	/** \brief Replaces the block by one of bytes; arrays handed out before become invalid
+	 * 	\param zero clears the block; without it no page is touched, so the owner's
+	 * 	threads can be the first to write (and place) their parts
+	 * 	\param pages how the block is allocated
+	 * 	\throws std::bad_alloc if the block can't be allocated
+	 */
+	void reset(size_t bytes, bool zero = true, PageMode pages = PAGES_MALLOC)
+	{
+		bytes = align(bytes);
+		block_.allocate(bytes, pages);
+		if (bytes && zero)
+		{
+			memset(block_.data(), 0, bytes);
+		}
+		used_ = 0;
+	}
+
+	/** \brief Next n elements of the block, 64 byte aligned; the block must have room for align(n * sizeof(T)) */
+	template<class T>
+	T *allocate(size_t n)
+	{
+		T *p = reinterpret_cast<T *>(static_cast<char *>(block_.data()) + used_);
+		used_ += align(n * sizeof(T));
+		return p;
+	}
+
+	/** \brief Size of the block */
+	size_t bytes() const { return block_.bytes(); }
+
+	/** \brief The block and how much of it is on huge pages */
+	PageUsage usage() const { return block_.usage(); }
+
+private:
+	PageBlock block_;
+	size_t used_;
+};
+
+}
+; // namespace
+#endif
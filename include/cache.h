@@ -11,8 +11,8 @@
  * @date June 2012
  * @par
  * This cache is thread safe if compiled with _REENTRANT defined.  It
- * uses the BOOST scientific computing library to provide the thread safety
- * mutexes.
+ * uses a single std::mutex around every operation; see sharded_cache.h
+ * for a variant that scales with the number of threads.
  *
  * @par
  * Thanks to graydon@pobox.com for the size counting functor.
@@ -26,8 +26,7 @@
  * 
  * Fast, thread safe C++ template with Least Recently Used (LRU)
  * removal semantics. Complete with a comprehensive unit test
- * suite. Threading features require the BOOST scientific library to be
- * installed.
+ * suite. Threading features only require a C++11 standard library.
  * 
  * @section usage_section Usage
  * 
@@ -43,13 +42,16 @@
  *
  * @example lru_example.cpp
  */
+#ifndef _CACHE_H
+#define _CACHE_H
+
 #include <map>
 #include <list>
 #include <vector>
 #ifdef _REENTRANT
-#include <boost/thread/mutex.hpp>
-/// If we are reentrant then use a BOOST scoped mutex where neccessary.
-#define SCOPED_MUTEX  boost::mutex::scoped_lock lock(this->_mutex);
+#include <mutex>
+/// If we are reentrant then use a scoped std::mutex lock where neccessary.
+#define SCOPED_MUTEX  std::lock_guard< std::mutex > lock(this->_mutex);
 #else
 /// If we aren't reentrant then don't do anything.
 #define SCOPED_MUTEX
@@ -60,7 +62,6 @@ struct Countfn {
 		unsigned long operator()( const T &x ) { return 1; }
 };
 
-
 /**
  * @brief Template cache with an LRU removal policy.
  * @class LRUCache
@@ -91,7 +92,7 @@ template< class Key, class Data, class Sizefn = Countfn< Data > > class LRUCache
 		unsigned long _curr_size; ///< Current abstract size of the cache
 
 #ifdef _REENTRANT
-		boost::mutex _mutex;
+		std::mutex _mutex;
 #endif
 
 	public:
@@ -274,3 +275,5 @@ template< class Key, class Data, class Sizefn = Countfn< Data > > class LRUCache
 			_remove( miter );
 		}
 };
+
+#endif
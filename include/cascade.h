@@ -0,0 +1,41 @@
+/** @file cascade.h
+ * @brief Cascade (divide and conquer) SVM training across cores
+ */
+#ifndef _CASCADE_H
+#define _CASCADE_H
+
+#include <solver.h>
+
+namespace MySVM {
+
+/**	\brief Trains solver with a cascade of independent sub-solvers
+ *
+ * 	The rows are shuffled and split into partitions that are trained in
+ * 	parallel by their own Solver instances. The support vectors of each pair
+ * 	of results are merged and retrained, warm started from their alphas, until
+ * 	one set is left (Graf et al., "Parallel Support Vector Machines: The
+ * 	Cascade SVM", 2005). Rows of the full problem that violate the KKT
+ * 	conditions of that model are fed back into the last set and it is retrained
+ * 	until none are left or maxRounds is reached. A final serial SMO pass over
+ * 	the full problem checks (and if needed fixes) the KKT conditions.
+ *
+ * 	solver.maxSeconds and solver.maxUpdates bound the whole cascade: the
+ * 	sub-solvers get what is left of them (the parts of a layer split the
+ * 	updates), and once one runs out the results so far are joined into the
+ * 	model without the remaining layers or the final pass. solver.maxGap stops
+ * 	each sub-solver at its own duality gap, and the final pass at the gap of
+ * 	the full problem.
+ *
+ * 	\param solver the full problem, after init(); holds the trained model on return
+ * 	\param partitions number of first layer partitions
+ * 	\param threads number of sub-solvers trained at once
+ * 	\param maxRounds limit on the feedback rounds before the final pass
+ * 	\param rounds set to the number of feedback rounds run
+ * 	\return Number of passes of all the sub-solvers and of the final SMO pass over all
+ * 	the data; their pairs are added to solver.updates the same way
+ */
+int trainCascade(Solver &solver, int partitions, int threads, int maxRounds, int *rounds);
+
+}
+; // namespace
+#endif
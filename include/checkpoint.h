@@ -0,0 +1,109 @@
+/** @file checkpoint.h
+ * @brief Periodic snapshots of an SMO run, so that a preempted job can resume
+ *
+ * A checkpoint holds everything the outer loop needs to carry on where it
+ * stood: alpha, the error cache, w, b, the loop state and the generator. The
+ * kernel cache is not saved; it refills on demand. The file is binary:
+ *
+ *	CheckpointHeader
+ *	double alpha[rows]
+ *	double error[rows]
+ *	double w[features]
+ *
+ * Copying the state is the only work on the training thread. Two buffers
+ * alternate: while a background thread writes one to filename.tmp and
+ * renames it over filename, the next snapshot is copied into the other, and
+ * a snapshot still waiting when a newer one arrives is replaced by it. A
+ * crash during a write therefore leaves the previous checkpoint intact.
+ */
+#ifndef _CHECKPOINT_H
+#define _CHECKPOINT_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <solver.h>
+
+namespace MySVM {
+
+#define CHECKPOINT_MAGIC "MSVMCKP"
+#define CHECKPOINT_VERSION 1
+
+struct CheckpointHeader {
+	char magic[8];		///< CHECKPOINT_MAGIC, nul terminated
+	uint32_t version;	///< CHECKPOINT_VERSION
+	uint32_t kernel;	///< KernelType
+	uint64_t rows;
+	uint64_t features;
+	double gamma;
+	uint64_t data;		///< fingerprint of the labels and a sample of the rows
+	uint64_t checksum;	///< FNV-1a of the arrays that follow
+	double b;
+	uint64_t updates;
+	int32_t passes;		///< LoopState
+	int32_t index;
+	int32_t numChanged;
+	int32_t examineAll;
+	uint64_t rng[4];	///< state of the solver's generator
+};
+
+class Checkpointer {
+public:
+	/**	\brief Starts the writer thread
+	 * 	\param interval seconds between checkpoints
+	 */
+	Checkpointer(const char *filename, double interval);
+
+	/** \brief Writes the snapshot still pending, then stops the writer */
+	~Checkpointer();
+
+	/** \brief Whether interval has passed since the last snapshot; reads the clock, so tight loops ask every few rows */
+	bool due();
+
+	/** \brief Copies the state of solver (its loop field included) and queues it for writing; syncs a lazy error cache first */
+	void save(Solver &solver);
+
+	/** \brief Returns once every queued snapshot is on disk */
+	void wait();
+
+	/**	\brief Restores a checkpoint into solver after its init(); train() then continues from solver.loop
+	 * 	\return 0 on success, 1 if the file can't be read, is malformed or belongs to another problem
+	 */
+	static int load(const char *filename, Solver *solver);
+
+	unsigned long written;		///< snapshots on disk
+	unsigned long superseded;	///< snapshots replaced by a newer one before they were written
+	unsigned long failures;		///< writes that failed
+	double copySeconds;			///< time the training thread spent copying state
+	double writeSeconds;		///< time the writer spent, in the background
+	size_t bytes;				///< size of one checkpoint
+
+private:
+	enum { FREE, READY, WRITING };
+
+	void writer();
+
+	std::string filename_;
+	double interval_;
+	double last_;
+	uint64_t data_;				///< fingerprint of the problem, taken at the first snapshot
+	std::vector<char> buffers_[2];
+	int state_[2];
+	int ready_;					///< buffer waiting for the writer, or -1
+	bool stop_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable idle_;
+	std::thread thread_;
+
+	// prevent copying and assignment; not implemented
+	Checkpointer(const Checkpointer &);
+	Checkpointer& operator=(const Checkpointer &);
+};
+
+}
+; // namespace
+#endif
@@ -0,0 +1,54 @@
+/** @file compact_model.h
+ * @brief A trained model packed for prediction
+ *
+ * Prediction only needs the rows with alpha > 0. Compaction gathers those
+ * support vectors into one 64 byte aligned block together with their
+ * coefficients y_i alpha_i and squared norms, so that the memory and the work
+ * of a prediction scale with the number of support vectors rather than with
+ * the training set. The rows are stored dense, padded to a multiple of eight
+ * doubles, unless that would take more than the dense limit (very sparse,
+ * high dimensional data), in which case they are stored sparse, back to back.
+ * Linear models keep only w.
+ */
+#ifndef _COMPACT_MODEL_H
+#define _COMPACT_MODEL_H
+
+#include <arena.h>
+#include <model.h>
+
+#define DENSE_SV_BYTES (256UL << 20)	// largest dense block of support vectors
+
+namespace MySVM {
+
+class CompactModel {
+public:
+	/** \brief Packs the support vectors (or w) of model */
+	explicit CompactModel(const Model &model, size_t denseLimit = DENSE_SV_BYTES);
+
+	KernelType kernelType;
+	double gamma;
+	double b;
+	int count;				///< support vectors, 0 for the linear kernel
+	int features;			///< largest index used by w or a support vector
+	int stride;				///< doubles per dense row
+	bool dense;				///< support vectors in rows, otherwise in sparse
+	const double *w;		//[features], linear kernel only
+	const double *coef;		//[count], y_i alpha_i
+	const double *norm;		//[count], |sv_i|^2
+	const double *rows;		//[count][stride], if dense
+	const Feature *const *sparse;	//[count], each terminated by index -1, if not dense
+
+	/** \brief Size of the packed block */
+	size_t bytes() const { return arena_.bytes(); }
+
+private:
+	Arena arena_;
+
+	// prevent copying and assignment: the pointers are into arena_; not implemented
+	CompactModel(const CompactModel &);
+	CompactModel& operator=(const CompactModel &);
+};
+
+}
+; // namespace
+#endif
@@ -0,0 +1,43 @@
+/** @file dataset.h
+ * @brief On-disk binary dataset format shared by the generator and the trainer.
+ *
+ * The binary format is a compressed sparse row dump of a libsvm file, so that
+ * large synthetic datasets can be loaded without re-parsing text:
+ *
+ *	DatasetHeader
+ *	double   y[rows]
+ *	uint64_t rowptr[rows + 1]	offsets into index/value for each row
+ *	int32_t  index[nnz]			1-based feature indices, as in libsvm
+ *	double   value[nnz]
+ *
+ * All fields are little endian, as written by the host.
+ */
+#ifndef _DATASET_H
+#define _DATASET_H
+
+#include <stdint.h>
+#include <string.h>
+
+namespace MySVM {
+
+#define DATASET_MAGIC "MSVMBIN"
+#define DATASET_VERSION 1
+
+struct DatasetHeader {
+	char magic[8];		///< DATASET_MAGIC, nul terminated
+	uint32_t version;	///< DATASET_VERSION
+	uint32_t reserved;
+	uint64_t rows;		///< number of training rows (N)
+	uint64_t features;	///< largest feature index (M)
+	uint64_t nnz;		///< total number of stored (index, value) pairs
+};
+
+/** \brief Checks whether a header read from disk describes a binary dataset */
+inline bool is_binary_dataset(const DatasetHeader &header)
+{
+	return memcmp(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC)) == 0;
+}
+
+}
+; // namespace
+#endif
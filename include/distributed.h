@@ -0,0 +1,145 @@
+/** @file distributed.h
+ * @brief Coordinator/worker training over Unix or TCP sockets
+ *
+ * The coordinator holds the labels, the alphas and the threshold; every worker
+ * process owns a contiguous shard of the training rows, densified, and the
+ * error cache for them. The coordinator never densifies more than the two rows
+ * of a step: the shards go out as sparse rows straight from the problem.
+ * Each iteration the workers report the extreme errors of their shard, the
+ * coordinator picks the maximal violating pair over all shards (Keerthi et
+ * al., "Improvements to Platt's SMO Algorithm", modification 2) that can
+ * still make progress, takes the step, and broadcasts the pair, the alpha
+ * deltas and the two rows so that the workers can update their errors.
+ * Nothing proportional to N crosses the wire after the shards have been sent,
+ * except when none of the reported pairs can move by more than step()'s
+ * threshold: then the coordinator asks for every worker's errors, holds them
+ * for as long as it searches all violating pairs, and drops them. Training has converged when the most violating pair
+ * violates the KKT conditions by no more than twice the tolerance; it stalls
+ * when pairs violate by more but none of them can move.
+ *
+ * Addresses are "unix:/path/to/socket" or "tcp:host:port".
+ *
+ * Messages are a MessageHeader followed by `bytes` bytes of payload, in host
+ * byte order (all processes run on compatible machines):
+ *
+ *	MSG_SHARD	coordinator -> worker	ShardHeader, y[rows], Feature x[elements + rows], each row ended by index -1
+ *	MSG_REPORT	worker -> coordinator	Report
+ *	MSG_UPDATE	coordinator -> worker	Update, x[index_i][features], x[index_j][features]
+ *	MSG_FINISH	coordinator -> worker	(empty)
+ *	MSG_ERRORS	worker -> coordinator	ShardHeader, error[rows]; the answer to MSG_FINISH and MSG_SCAN
+ *	MSG_SCAN	coordinator -> worker	(empty); the worker answers and then waits for the next message
+ *
+ * A peer announcing a payload other than the size its header implies is
+ * dropped before anything is allocated for it.
+ */
+#ifndef _DISTRIBUTED_H
+#define _DISTRIBUTED_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <vector>
+#include <problem.h>
+#include <solver.h>
+
+namespace MySVM {
+
+enum MessageType {
+	MSG_SHARD = 1,
+	MSG_REPORT,
+	MSG_UPDATE,
+	MSG_FINISH,
+	MSG_ERRORS,
+	MSG_SCAN
+};
+
+struct MessageHeader {
+	uint32_t type;		///< MessageType
+	uint32_t reserved;
+	uint64_t bytes;		///< payload size
+};
+
+struct ShardHeader {
+	int64_t begin;		///< global index of the first row of the shard
+	int64_t rows;
+	int64_t features;
+	int64_t elements;	///< stored features of the shard's rows, terminators excluded
+	int64_t kernel;		///< KernelType
+	double gamma;
+};
+
+#define REPORT_CANDIDATES 8
+
+/**
+ * \brief Extreme errors of a shard, best first; indices are global and -1 pads short lists
+ *
+ * Several candidates are reported per side because the most violating pair
+ * may not be able to move by more than the step threshold, in which case the
+ * coordinator falls back to the next most violating pair, and to a scan of all
+ * the rows when none of the reported ones can move.
+ */
+struct Report {
+	int64_t index_up[REPORT_CANDIDATES];	///< smallest E over I_up = {y = +1, alpha < C} u {y = -1, alpha > 0}
+	double error_up[REPORT_CANDIDATES];
+	int64_t index_low[REPORT_CANDIDATES];	///< largest E over I_low = {y = +1, alpha > 0} u {y = -1, alpha < C}
+	double error_low[REPORT_CANDIDATES];
+};
+
+/** \brief One committed step, as broadcast to the workers */
+struct Update {
+	int64_t index_i;
+	int64_t index_j;
+	double alpha_i;
+	double alpha_j;
+	double delta_i;		///< y_i * (change of alpha_i)
+	double delta_j;		///< y_j * (change of alpha_j)
+	double db;			///< change of the threshold
+};
+
+/**
+ * \brief The coordinator's side of distributed training
+ *
+ * Keeps y (borrowed from the problem), the alphas and the threshold, and
+ * reads the sparse rows of the problem to send the shards and to densify the
+ * two rows of each step; its memory does not grow with the dense matrix.
+ */
+class Coordinator {
+public:
+	std::vector<double> alpha;	//[N]
+	double b;
+	KernelType kernelType;
+	double gamma;
+	double tolerance;			///< KKT violations up to this much are accepted
+	unsigned long updates;		///< steps taken
+	long scans;					///< scans of all the rows, when no reported pair could step
+	const char *stopReason;		///< converged or stalled
+	Progress result;			///< objective, gap and KKT violation at the end, from the workers' errors
+	std::vector<pid_t> children;	///< local worker processes; train() fails if one exits before connecting
+
+	/**	\brief Sets up a coordinator over prob's rows, with all alphas at 0; prob must outlive it */
+	explicit Coordinator(const Problem &prob);
+
+	/**	\brief Trains as the coordinator of a group of worker processes
+	 * 	\param address where to listen for the workers
+	 * 	\param workers number of workers to wait for
+	 * 	\return Number of rounds of reports, or -1 on a communication failure
+	 */
+	long train(const char *address, int workers);
+
+	const Problem &problem() const { return prob_; }
+
+private:
+	const Problem &prob_;
+
+	// prevent copying and assignment; not implemented
+	Coordinator(const Coordinator &);
+	Coordinator& operator=(const Coordinator &);
+};
+
+/**	\brief Runs a worker: connects to the coordinator and serves its shard until told to finish
+ * 	\return 0 on success, 1 on failure
+ */
+int runWorker(const char *address);
+
+}
+; // namespace
+#endif
@@ -0,0 +1,62 @@
+/** @file evaluate.h
+ * @brief Batched scoring of a problem with a trained model
+ *
+ * The rows are split over threads and scored in blocks: for the linear kernel
+ * X w - b row by row with two independent accumulators, for the RBF kernel a
+ * block of rows is expanded into dense scratch rows and every support vector
+ * of the compacted model is applied to the whole block while it sits in cache, with
+ * |x - sv|^2 = |x|^2 + |sv|^2 - 2 <x, sv>. Both inner loops are compiled
+ * twice on x86-64 GCC, plain and for AVX2, and the loader picks the one the
+ * CPU supports. The confusion counts are gathered in the same pass; the AUC
+ * needs the scores in order and comes from one sort of the values afterwards.
+ */
+#ifndef _EVALUATE_H
+#define _EVALUATE_H
+
+#include <vector>
+#include <problem.h>
+#include <model.h>
+#include <compact_model.h>
+
+namespace MySVM {
+
+/** \brief Result of scoring labelled rows; a row is positive when y > 0 and predicted positive when f(x) > 0 */
+struct Evaluation {
+	long rows;
+	long truePositives;
+	long falsePositives;
+	long trueNegatives;
+	long falseNegatives;
+	double auc;			///< area under the ROC curve, ties counted as half
+	double seconds;		///< time of the scoring pass with its counts; the AUC sort comes after
+
+	Evaluation() :
+		rows(0), truePositives(0), falsePositives(0), trueNegatives(0), falseNegatives(0),
+		auc(0), seconds(0) {}
+
+	double accuracy() const
+	{
+		return rows ? (double) (truePositives + trueNegatives) / rows : 0;
+	}
+
+	/** \brief Prints accuracy, AUC, throughput and the confusion matrix, prefixed by what */
+	void print(const char *what) const;
+};
+
+/**	\brief Scores every row of prob with model
+ * 	\param threads at least one is used
+ * 	\param values set to f(x) of each row, or NULL
+ */
+Evaluation evaluate(const CompactModel &model, const Problem &prob, int threads, std::vector<double> *values);
+
+/**	\brief f(x) of a single row, the low latency path
+ * 	\param scratch model.stride zeros, left zero; grown when shorter
+ */
+double decision_value(const CompactModel &model, const Feature *x, std::vector<double> *scratch);
+
+/** \brief evaluate() after packing model and applying its feature map; reuse a CompactModel to score several problems */
+Evaluation evaluate(const Model &model, const Problem &prob, int threads, std::vector<double> *values);
+
+}
+; // namespace
+#endif
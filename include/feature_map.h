@@ -0,0 +1,73 @@
+/** @file feature_map.h
+ * @brief Explicit feature maps that approximate the RBF kernel
+ *
+ * Training with an exact kernel costs O(N^2) kernel evaluations. Mapping each
+ * row to z(x) in R^D with <z(x), z(y)> ~ exp(-gamma |x - y|^2) turns the
+ * problem into a linear one that the linear engines solve in time about
+ * linear in N.
+ *
+ * Random Fourier features (Rahimi and Recht, 2007):
+ * z_j(x) = sqrt(2 / D) cos(<omega_j, x> + phase_j), omega_j ~ N(0, 2 gamma I),
+ * phase_j ~ U[0, 2 pi). omega and the phases are drawn from the seed, so a
+ * model stores only the seed; the D x M matrix must fit in memory.
+ *
+ * Nystroem (Williams and Seeger, 2001): D landmark rows drawn from the data,
+ * z(x) = L^-1 k(x) with k_j(x) = K(landmark_j, x) and L L' = K_landmarks + eps I.
+ * Costs D kernel evaluations and a D x D triangular solve per row, and works
+ * for sparse data of any dimension.
+ */
+#ifndef _FEATURE_MAP_H
+#define _FEATURE_MAP_H
+
+#include <vector>
+#include <stdint.h>
+#include <problem.h>
+
+namespace MySVM {
+
+enum MapType {
+	MAP_NONE,
+	MAP_RFF,		///< random Fourier features
+	MAP_NYSTROEM	///< Nystroem projection onto landmark rows
+};
+
+class FeatureMap {
+public:
+	MapType type;
+	double gamma;
+	int dim;			///< D, the mapped dimension
+	int features;		///< input features covered; larger indices are ignored
+	uint64_t seed;
+
+	// Nystroem only, kept in the model file
+	std::vector< std::vector<Feature> > landmarks;	//[D]
+	std::vector<double> factor;	//[D][D], lower triangular L, row major
+
+	FeatureMap() : type(MAP_NONE), gamma(0), dim(0), features(0), seed(1) {}
+
+	/** \brief Random Fourier features for inputs of up to features indices; throws std::bad_alloc if D x features is too large */
+	void fitRff(int features, double gamma, int dim, uint64_t seed);
+
+	/** \brief Nystroem map on dim landmarks drawn from the rows of prob (fewer if prob is smaller) */
+	void fitNystroem(const Problem &prob, double gamma, int dim, uint64_t seed);
+
+	/** \brief Rebuilds what the model file leaves out (the RFF matrix, the landmark norms) */
+	void prepare();
+
+	/** \brief z(x) into z[0, dim) */
+	void apply(const Feature *x, double *z) const;
+
+	/**	\brief Maps every row of in into out, rows split over threads
+	 * 	\param out dense rows of dim features, labels copied
+	 */
+	void apply(const Problem &in, Problem *out, int threads) const;
+
+private:
+	std::vector<double> omega_;		//[features][D], RFF
+	std::vector<double> phase_;		//[D], RFF
+	std::vector<double> norm_;		//[D], |landmark_j|^2
+};
+
+}
+; // namespace
+#endif
@@ -0,0 +1,89 @@
+/** @file huge_pages.h
+ * @brief Large blocks backed by huge pages, for the training matrix and the solver state
+ *
+ * A dense training matrix or kernel cache of many GB spans millions of 4 KB
+ * pages, far more than the TLB maps, so random rows and columns miss it.
+ * Backed by 2 MB pages the same data needs 512 times fewer entries:
+ *
+ *	PAGES_TRANSPARENT	anonymous mmap aligned to the huge page size and marked
+ *						madvise(MADV_HUGEPAGE); the kernel backs it with huge pages
+ *						as they are touched, as far as it finds free ones
+ *	PAGES_HUGETLB		mmap(MAP_HUGETLB) from the pool reserved in
+ *						/proc/sys/vm/nr_hugepages; all or nothing
+ *
+ * Neither is guaranteed: hugetlb falls back to transparent pages when the
+ * pool is short, transparent pages to plain ones when THP is disabled, and
+ * blocks smaller than one huge page are plain allocations. usage() tells how
+ * much of a block ended up huge.
+ */
+#ifndef _HUGE_PAGES_H
+#define _HUGE_PAGES_H
+
+#include <cstddef>
+
+namespace MySVM {
+
+enum PageMode {
+	PAGES_MALLOC,		///< aligned_alloc, the default
+	PAGES_TRANSPARENT,	///< madvise(MADV_HUGEPAGE)
+	PAGES_HUGETLB		///< MAP_HUGETLB, then as PAGES_TRANSPARENT
+};
+
+/** \brief Name of mode: malloc, thp or hugetlb */
+const char *page_mode_name(PageMode mode);
+
+/** \brief Size of some memory and the part of it on huge pages */
+struct PageUsage {
+	size_t bytes;
+	size_t huge;
+
+	PageUsage() : bytes(0), huge(0) {}
+
+	void add(const PageUsage &other) { bytes += other.bytes; huge += other.huge; }
+};
+
+/**	\brief Reads from /proc/self/smaps how much of [data, data + bytes) sits on huge pages
+ *
+ * 	smaps counts huge pages per mapping; a mapping that also holds other
+ * 	memory (as malloc's arenas do) is attributed in proportion to the overlap.
+ */
+PageUsage page_usage(const void *data, size_t bytes);
+
+/** \brief One block of memory, 64 byte aligned, allocated as a PageMode asks */
+class PageBlock {
+public:
+	PageBlock() : data_(NULL), bytes_(0), mapped_(0), mode_(PAGES_MALLOC) {}
+	~PageBlock() { release(); }
+
+	/**	\brief Replaces the block by one of bytes; its contents are undefined, and the
+	 * 	pages of a mapped block are untouched until written
+	 * 	\throws std::bad_alloc if no mode down to plain allocation succeeds
+	 */
+	void *allocate(size_t bytes, PageMode mode);
+
+	/** \brief Frees the block */
+	void release();
+
+	void *data() const { return data_; }
+	size_t bytes() const { return bytes_; }
+
+	/** \brief How the block was allocated, after any fallback */
+	PageMode mode() const { return mode_; }
+
+	/** \brief page_usage() of the block */
+	PageUsage usage() const { return page_usage(data_, bytes_); }
+
+private:
+	void *data_;
+	size_t bytes_;
+	size_t mapped_;		///< length of the mapping, 0 for an aligned_alloc block
+	PageMode mode_;
+
+	// prevent copying and assignment; not implemented
+	PageBlock(const PageBlock &);
+	PageBlock& operator=(const PageBlock &);
+};
+
+}
+; // namespace
+#endif
@@ -0,0 +1,101 @@
+/** @file kernel_cache.h
+ * @brief Cache of kernel columns K(i, .) for the solver
+ */
+#ifndef _KERNEL_CACHE_H
+#define _KERNEL_CACHE_H
+
+#include <cache.h>
+#include <lru_cache.h>
+#include <huge_pages.h>
+#include <vector>
+
+namespace MySVM {
+
+/** \brief A cached kernel column of K(i, r) for every training row r */
+struct KernelColumn {
+	double *data;
+};
+
+/**
+ * \brief Keeps the most recently used kernel columns within a byte budget
+ *
+ * Each column holds K(i, r) for all training rows r and is charged its bytes;
+ * the least recently used ones are freed until a new column fits, so memory
+ * stays bounded regardless of the number of rows.
+ * Recency is tracked by the preallocated MySVM::LRUCache, one entry per row.
+ *
+ * The columns are slots of one slab allocated up front, taken and given back
+ * as columns come and go, so a miss neither allocates nor faults in fresh
+ * pages once the slot has been used.
+ */
+class KernelCache {
+public:
+	/** \brief Creates an empty cache
+	 * 	\param length number of training rows, i.e. the length of every column
+	 * 	\param bytes memory budget; raised to two full columns if smaller
+	 * 	\param pages how the slab of column slots is allocated
+	 */
+	KernelCache(int length, unsigned long bytes, PageMode pages = PAGES_MALLOC);
+	~KernelCache();
+
+	/** \brief Fetches index's column, making it the most recently used
+	 * 	\param cached set to whether the column was cached; if not, the caller computes it
+	 * 	\return column buffer, valid until the next two column() calls
+	 */
+	double *column(int index, bool *cached);
+
+	/** \brief index's column if it is cached, else NULL; recency and counters are left alone */
+	const double *peek(int index)
+	{
+		KernelColumn *col = lru_.peek(index);
+		return (col != NULL) ? col->data : NULL;
+	}
+
+	/** \brief Bytes currently held by cached columns */
+	unsigned long bytes() const { return used_; }
+
+	/** \brief Largest value bytes() has reached */
+	unsigned long peak_bytes() const { return peak_; }
+
+	/** \brief Memory budget in bytes */
+	unsigned long max_bytes() const { return budget_; }
+
+	/** \brief Number of cached columns */
+	unsigned long columns() const { return lru_.size(); }
+
+	/** \brief Number of columns the budget holds, at least two; the last capacity() fetched are all still cached */
+	unsigned long capacity() const { return budget_ / charge(); }
+
+	/** \brief The slab and how much of it is on huge pages */
+	PageUsage usage() const { return slab_.usage(); }
+
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long evictions;
+
+private:
+	/** \brief Frees least recently used columns, other than keep, until bytes more fit */
+	void reserve(unsigned long bytes, int keep);
+
+	/** \brief Bytes charged for a column */
+	unsigned long charge() const;
+
+	/** \brief Gives data back to the free slots of the slab */
+	void release(double *data);
+
+	unsigned long budget_;
+	unsigned long used_;
+	unsigned long peak_;
+	LRUCache<int, KernelColumn> lru_;
+	int length_;
+	PageBlock slab_;
+	std::vector<double *> freeSlots_;	///< slots of the slab not holding a column
+
+	// prevent copying and assignment; not implemented
+	KernelCache(const KernelCache &);
+	KernelCache& operator=(const KernelCache &);
+};
+
+}
+; // namespace
+#endif
@@ -0,0 +1,57 @@
+/** @file linear_solver.h
+ * @brief Dual coordinate descent for linear SVMs on sparse rows
+ *
+ * The engine of LIBLINEAR for the L1-loss (hinge) SVM: Hsieh et al., "A Dual
+ * Coordinate Descent Method for Large-scale Linear SVM", ICML 2008. The dual
+ * is minimized one alpha at a time, in a random order every pass, with w kept
+ * up to date so that each step costs one sparse dot product and one sparse
+ * axpy; there are no kernel evaluations and no error cache. Alphas that sit at
+ * a bound with a gradient pushing them outwards are shrunk out of the active
+ * set, as in LIBLINEAR.
+ *
+ * A single coordinate cannot move while sum(alpha_i y_i) = 0 holds, so the
+ * threshold is learnt as the weight of a constant feature of value 1 (b is its
+ * negated weight). This regularizes b along with w, so the model is close to,
+ * but not exactly, the one SMO finds for the same C.
+ */
+#ifndef _LINEAR_SOLVER_H
+#define _LINEAR_SOLVER_H
+
+#include <vector>
+#include <problem.h>
+#include <random.h>
+
+namespace MySVM {
+
+class LinearSolver {
+public:
+	std::vector<double> alpha;	//[N]
+	std::vector<double> w;		//[M]
+	double b;					///< threshold, f(x) = <w, x> - b
+	uint64_t seed;				///< seeds the order of the coordinates in train()
+	const char *stopReason;		///< why train() ended: converged, or passes at maxPasses
+
+	/**	\brief Sets up a solver over prob's rows, with all alphas at 0; prob must outlive it */
+	explicit LinearSolver(const Problem &prob);
+
+	/**	\brief Runs coordinate descent passes until the projected gradients of all
+	 * 	alphas are within eps of each other, or maxPasses is reached
+	 * 	\param cost upper bound C on the alphas
+	 * 	\param maxPasses limit on the passes; reaching it says so on stderr
+	 * 	\return Number of passes over the active set
+	 */
+	int train(double cost, double eps, int maxPasses);
+
+	/**	\brief Dual objective sum(alpha) - 1/2 (|w|^2 + b^2) */
+	double objective() const;
+
+	/** \brief Number of alphas greater than 0 */
+	int supportVectors() const;
+
+private:
+	const Problem &prob_;
+};
+
+}
+; // namespace
+#endif
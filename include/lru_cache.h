@@ -1,21 +1,268 @@
-#include <iostream>
+/** @file lru_cache.h
+ * @brief Fixed capacity, allocation free LRU cache with an intrusive recency list
+ *
+ * Every entry is preallocated at construction and linked into a doubly linked
+ * recency list through its own prev/next pointers; an open addressing hash
+ * table (linear probing, backward shift deletion) maps keys to entries. get()
+ * and insert() are O(1) and never allocate, which makes the cache suitable for
+ * the kernel row cache on the SMO hot path.
+ *
+ * Unlike LRUCache in cache.h, entries own their value slot for the lifetime of
+ * the cache: insert() recycles the least recently used entry and hands back its
+ * slot with the previous value still in place, so large payloads (kernel rows)
+ * can be reused instead of reallocated.
+ */
+#ifndef _LRU_CACHE_H
+#define _LRU_CACHE_H
+
 #include <vector>
-#include <hash_map>
+#include <cstddef>
+#include <functional>
 
 // taken from: http://www.cs.uml.edu/~jlu1/doc/codes/lruCache.html
 // modify with: http://timday.bitbucket.org/lru.html
 
+namespace MySVM {
+
 template<class K, class V>
-struct LRUCacheEntry 
+struct LRUCacheEntry
 {
-				K key;
-				V value;
-				LRUCacheEntry* prev;
-				LRUCacheEntry* next;
+	K key;
+	V value;
+	LRUCacheEntry* prev;
+	LRUCacheEntry* next;
 };
 
-template<class K, class V>
+template<class K, class V, class Hash = std::hash<K> >
 class LRUCache
 {
-private: 
-				hash_map< K, LRUCacheEntry
+private:
+	typedef LRUCacheEntry<K, V> Entry;
+
+	std::vector<Entry> entries_;	// preallocated pool, never resized
+	std::vector<Entry*> table_;		// open addressing index, NULL marks an empty bucket
+	size_t mask_;					// table_.size() - 1
+	Entry head_;					// sentinel: head_.next is the most recently used entry
+	Entry* free_;					// unused entries, chained through next
+	size_t size_;
+
+public:
+	/** \brief Creates a cache holding at most capacity entries; all memory is allocated here
+	 * 	\param capacity number of entries, at least 1
+	 */
+	explicit LRUCache(size_t capacity) :
+		entries_(capacity > 0 ? capacity : 1), size_(0)
+	{
+		size_t buckets = 2;
+		while (buckets < 2 * entries_.size())
+		{
+			buckets <<= 1;
+		}
+		table_.assign(buckets, (Entry*) NULL);
+		mask_ = buckets - 1;
+		reset();
+	}
+
+	/** \brief Number of entries currently cached */
+	size_t size() const { return size_; }
+
+	/** \brief Maximum number of entries */
+	size_t capacity() const { return entries_.size(); }
+
+	/** \brief Value slot of the n-th preallocated entry, for initializing payloads before use */
+	V& slot(size_t n) { return entries_[n].value; }
+
+	/** \brief Looks up key and makes it the most recently used entry
+	 * 	\return pointer to the cached value, or NULL on a miss
+	 */
+	V* get(const K& key)
+	{
+		Entry* entry = table_[find(key)];
+		if (entry == NULL)
+		{
+			return NULL;
+		}
+		unlink(entry);
+		push_front(entry);
+		return &entry->value;
+	}
+
+	/** \brief Looks up key without changing its recency */
+	V* peek(const K& key)
+	{
+		Entry* entry = table_[find(key)];
+		return entry ? &entry->value : NULL;
+	}
+
+	/** \brief Least recently used entry, without changing its recency
+	 * 	\param key set to the entry's key (may be NULL)
+	 * 	\return pointer to its value, or NULL when the cache is empty
+	 */
+	V* oldest(K* key)
+	{
+		if (head_.prev == &head_)
+		{
+			return NULL;
+		}
+		if (key)
+		{
+			*key = head_.prev->key;
+		}
+		return &head_.prev->value;
+	}
+
+	/** \brief Claims an entry for key, evicting the least recently used entry when full
+	 * 	\param evicted set to whether an entry was evicted to make room (may be NULL)
+	 * 	\return slot for key's value; it still holds the value of the recycled entry
+	 */
+	V* insert(const K& key, bool* evicted = NULL)
+	{
+		if (evicted)
+		{
+			*evicted = false;
+		}
+
+		size_t bucket = find(key);
+		Entry* entry = table_[bucket];
+		if (entry != NULL)
+		{
+			unlink(entry);
+			push_front(entry);
+			return &entry->value;
+		}
+
+		if (free_ != NULL)
+		{
+			entry = free_;
+			free_ = entry->next;
+			++size_;
+		}
+		else
+		{
+			entry = head_.prev;
+			unlink(entry);
+			erase(find(entry->key));
+			bucket = find(key); // the backward shift may have moved key's bucket
+			if (evicted)
+			{
+				*evicted = true;
+			}
+		}
+
+		entry->key = key;
+		table_[bucket] = entry;
+		push_front(entry);
+		return &entry->value;
+	}
+
+	/** \brief Inserts or replaces key's value */
+	V* put(const K& key, const V& value)
+	{
+		V* slot = insert(key);
+		*slot = value;
+		return slot;
+	}
+
+	/** \brief Drops key from the cache; its entry (and value slot) goes back to the pool
+	 * 	\return whether key was cached
+	 */
+	bool remove(const K& key)
+	{
+		size_t bucket = find(key);
+		Entry* entry = table_[bucket];
+		if (entry == NULL)
+		{
+			return false;
+		}
+		unlink(entry);
+		erase(bucket);
+		entry->next = free_;
+		free_ = entry;
+		--size_;
+		return true;
+	}
+
+	/** \brief Drops every key; value slots keep their contents */
+	void clear()
+	{
+		for (size_t i = 0; i < table_.size(); i++)
+		{
+			table_[i] = NULL;
+		}
+		reset();
+	}
+
+private:
+	void reset()
+	{
+		head_.prev = &head_;
+		head_.next = &head_;
+		free_ = NULL;
+		for (size_t i = entries_.size(); i-- > 0;)
+		{
+			entries_[i].prev = NULL;
+			entries_[i].next = free_;
+			free_ = &entries_[i];
+		}
+		size_ = 0;
+	}
+
+	size_t home(const K& key) const
+	{
+		// Fibonacci mixing, so that sequential integer keys do not cluster
+		unsigned long long h = (unsigned long long) Hash()(key) * 0x9E3779B97F4A7C15ULL;
+		return (size_t) (h >> 32) & mask_;
+	}
+
+	/** \brief Returns key's bucket, or the empty bucket where it would be inserted */
+	size_t find(const K& key) const
+	{
+		size_t bucket = home(key);
+		while (table_[bucket] != NULL && !(table_[bucket]->key == key))
+		{
+			bucket = (bucket + 1) & mask_;
+		}
+		return bucket;
+	}
+
+	/** \brief Empties a bucket, shifting later members of the probe run back into the hole */
+	void erase(size_t hole)
+	{
+		table_[hole] = NULL;
+		size_t bucket = (hole + 1) & mask_;
+		while (table_[bucket] != NULL)
+		{
+			size_t want = home(table_[bucket]->key);
+			// move the entry back if its home is not cyclically within (hole, bucket]
+			if (((bucket - want) & mask_) >= ((bucket - hole) & mask_))
+			{
+				table_[hole] = table_[bucket];
+				table_[bucket] = NULL;
+				hole = bucket;
+			}
+			bucket = (bucket + 1) & mask_;
+		}
+	}
+
+	void unlink(Entry* entry)
+	{
+		entry->prev->next = entry->next;
+		entry->next->prev = entry->prev;
+	}
+
+	void push_front(Entry* entry)
+	{
+		entry->prev = &head_;
+		entry->next = head_.next;
+		head_.next->prev = entry;
+		head_.next = entry;
+	}
+
+	// prevent copying and assignment: entries point into each other; not implemented
+	LRUCache(const LRUCache &);
+	LRUCache& operator=(const LRUCache &);
+};
+
+}
+; // namespace
+#endif
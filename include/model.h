@@ -0,0 +1,74 @@
+/** @file model.h
+ * @brief Trained models and the model file shared by all training engines
+ *
+ * The decision function is f(x) = <w, x> - b for the linear kernel and
+ * f(x) = sum_i coef_i K(sv_i, x) - b otherwise, with coef_i = y_i alpha_i.
+ * Model files are text, in the spirit of libsvm's:
+ *
+ *	kernel_type linear|rbf
+ *	gamma <gamma>			(rbf only)
+ *	features <M>
+ *	b <b>
+ *	map rff <D> <M> <gamma> <seed>	(optional, see feature_map.h)
+ *	map nystroem <D> <M> <gamma>	(optional: D rows of L, row i with i + 1 values,
+ *							then D landmark lines "0 index:value ...")
+ *	w						(linear: M weights follow, one per line)
+ *	SV <count>				(rbf: count lines "coef index:value ..." follow)
+ *
+ * A model with a feature map is linear in its D mapped features (features
+ * and w count those); every input row goes through the map first.
+ */
+#ifndef _MODEL_H
+#define _MODEL_H
+
+#include <vector>
+#include <solver.h>
+#include <linear_solver.h>
+#include <sgd_solver.h>
+#include <distributed.h>
+#include <problem.h>
+#include <feature_map.h>
+
+namespace MySVM {
+
+struct Model {
+	KernelType kernelType;
+	double gamma;
+	int features;
+	double b;
+	std::vector<double> w;						///< linear kernel only
+	std::vector<double> coef;					///< y_i alpha_i of each support vector
+	std::vector< std::vector<Feature> > sv;		///< support vectors, each terminated by index -1
+	FeatureMap map;								///< applied to the inputs first, MAP_NONE for none
+
+	Model() : kernelType(KERNEL_LINEAR), gamma(0), features(0), b(0) {}
+};
+
+/** \brief Extracts the model trained by an SMO solver (w for the linear kernel, support vectors otherwise) */
+void build_model(const Solver &solver, Model *model);
+
+/** \brief Extracts the model trained by dual coordinate descent */
+void build_model(const LinearSolver &solver, Model *model);
+
+/** \brief Extracts the averaged weights trained by mini-batch SGD */
+void build_model(const SGDSolver &solver, Model *model);
+
+/** \brief Extracts the model trained by distributed SMO, from the coordinator's alphas and sparse rows */
+void build_model(const Coordinator &coordinator, Model *model);
+
+/** \brief Writes model to filename in the format above, reals with precision significant digits
+ * 	\throws std::runtime_error on failure
+ */
+void save_model(const char *filename, const Model &model, int precision = 17);
+
+/** \brief Reads a model written by save_model()
+ * 	\return 0 on success, 1 if the file can't be opened or is malformed
+ */
+int load_model(const char *filename, Model *model);
+
+/** \brief Decision value f(x) of a sparse row; the sign is the predicted label */
+double decision_value(const Model &model, const Feature *x);
+
+}
+; // namespace
+#endif
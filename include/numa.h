@@ -0,0 +1,60 @@
+/** @file numa.h
+ * @brief Thread binding and NUMA placement of the parallel SMO data
+ *
+ * Linux places a page on the node of the thread that first writes it. The
+ * parallel SMO loop gives thread t the same contiguous range of rows in
+ * every job (ThreadPool::range), so when the dense rows and the per-row
+ * state are first written by pinned threads over those ranges, each thread
+ * later reads its rows from local memory. Binding maps thread t to one cpu:
+ *
+ *	compact		fills the cpus of node 0 first, then node 1, ...
+ *	spread		takes the nodes in turn, so every node gets a share of threads
+ *
+ * The topology comes from /sys/devices/system/node, restricted to the cpus
+ * the process may run on. Without that directory, or with a single node,
+ * there is one node and both bindings only pin the threads.
+ */
+#ifndef _NUMA_H
+#define _NUMA_H
+
+#include <vector>
+#include <string>
+
+namespace MySVM {
+
+enum Binding {
+	BIND_NONE,		///< threads float, pages land where the kernel puts them
+	BIND_COMPACT,	///< consecutive threads on the same node
+	BIND_SPREAD		///< consecutive threads on different nodes
+};
+
+/** \brief Cpus of each NUMA node the process may use */
+struct Topology {
+	std::vector< std::vector<int> > nodes;	///< allowed cpus of each node with any, in increasing order
+
+	/** \brief Reads the topology of this machine; falls back to one node holding every allowed cpu */
+	static Topology detect();
+
+	/** \brief Allowed cpus in all */
+	int cpus() const;
+
+	/** \brief Node of cpu, -1 if it isn't allowed */
+	int node(int cpu) const;
+
+	/** \brief Nodes as "0-7 | 8-15" */
+	std::string describe() const;
+};
+
+/**	\brief Cpu of each of threads threads under binding; threads beyond the cpus wrap around
+ * 	\return threads cpus, or none for BIND_NONE
+ */
+std::vector<int> bind_cpus(const Topology &topology, Binding binding, int threads);
+
+/**	\brief Pins the calling thread to cpu
+ * 	\return 0 on success, an errno value otherwise
+ */
+int pin_thread(int cpu);
+
+}
+; // namespace
+#endif
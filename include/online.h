@@ -0,0 +1,89 @@
+/** @file online.h
+ * @brief Online training over a stream of libsvm records
+ *
+ * Records are read from stdin or from a file that is followed as it grows
+ * (like tail -f), scored with the current model and then used to update it
+ * in mini-batches. The model is a kernel expansion f(x) = sum_i coef_i
+ * K(sv_i, x) - b trained by budgeted stochastic gradient descent on the
+ * regularized hinge loss (Wang, Crammer and Vucetic, "Breaking the Curse of
+ * Kernelization: Budgeted Stochastic Gradient Descent for Large-Scale SVM
+ * Training", JMLR 2012): every record of a batch with y f(x) < 1 becomes a
+ * support vector, all coefficients decay by (1 - eta lambda), and once there
+ * are more than `budget` support vectors the one whose removal changes the
+ * model least, coef^2 K(sv, sv), is removed from the class with more of them.
+ * The threshold is not regularized; it takes plain SGD steps of 1 / sqrt(t).
+ * Regularizing it along with the coefficients (through a constant added to
+ * the kernel) shrinks it so fast at small lambda that one class takes over.
+ */
+#ifndef _ONLINE_H
+#define _ONLINE_H
+
+#include <vector>
+#include <solver.h>
+#include <problem.h>
+#include <model.h>
+
+namespace MySVM {
+
+struct OnlineOptions {
+	KernelType kernelType;
+	double gamma;			///< RBF width; 0 picks 1 / (largest index of the first batch)
+	double lambda;			///< regularization, eta_t = 1 / (lambda t)
+	int budget;				///< support vectors kept
+	int batch;				///< records per update
+	bool follow;			///< at the end of the file wait for more data instead of stopping
+	long report;			///< records between progress lines, 0 for none
+	const char *model_file;	///< written when the stream ends, or NULL
+
+	OnlineOptions() :
+		kernelType(KERNEL_LINEAR), gamma(0), lambda(1e-4), budget(500), batch(16),
+		follow(false), report(10000), model_file(NULL) {}
+};
+
+class OnlineSolver {
+public:
+	OnlineSolver(KernelType kernelType, double gamma, double lambda, int budget);
+
+	/** \brief f(x) = sum_i coef_i K(sv_i, x) - b */
+	double decision(const Feature *x) const;
+
+	/**	\brief One mini-batch step over rows[0, count)
+	 * 	\param scores f(x) of each row under the current model, as returned by decision()
+	 */
+	void update(const Feature *const *rows, const double *y, const double *scores, int count);
+
+	/** \brief Number of support vectors */
+	int size() const { return sv_.size(); }
+
+	/** \brief Records seen by update() */
+	long steps() const { return t_; }
+
+	/** \brief Writes the expansion as a model (w for the linear kernel) */
+	void build(Model *model) const;
+
+	double gamma;
+
+private:
+	double kernel(const Feature *a, double norm_a, int k) const;
+	void rescale();
+
+	KernelType kernelType_;
+	double lambda_;
+	int budget_;
+	long t_;
+	long batches_;
+	double scale_;		// coefficients are scale_ * coef_, so the decay is O(1)
+	double bias_;		// threshold term of f, -b; not regularized
+	std::vector< std::vector<Feature> > sv_;
+	std::vector<double> coef_;
+	std::vector<double> norm_;	// <sv_i, sv_i>
+};
+
+/**	\brief Trains online on the records of path ("-" for stdin) until the stream ends or SIGINT/SIGTERM
+ * 	\return 0 on success, 1 if the input can't be opened or the model can't be written
+ */
+int runOnline(const char *path, const OnlineOptions &options);
+
+}
+; // namespace
+#endif
@@ -0,0 +1,139 @@
+/** @file problem.h
+ * @brief Training data as read from disk, in sparse row form
+ *
+ * Rows keep only their stored features, as (index, value) pairs in increasing
+ * index order and terminated by an index of -1 (the libsvm convention), so
+ * high-dimensional sparse data costs memory in proportion to its nonzeros.
+ * The SMO solver works on dense rows and gets them from densify(); the linear
+ * engines work on the sparse rows directly.
+ */
+#ifndef _PROBLEM_H
+#define _PROBLEM_H
+
+#include <vector>
+#include <huge_pages.h>
+
+namespace MySVM {
+
+class ThreadPool;
+
+/** \brief One stored feature of a row */
+struct Feature {
+	int index;		///< 1-based feature index, -1 ends the row
+	double value;
+};
+
+struct Problem {
+	int length;			///< number of rows (N)
+	int features;		///< largest feature index (M)
+	long elements;		///< stored features over all rows, terminators excluded
+	double *y;			//[N]
+	Feature **x;		//[N], rows point into space
+	Feature *space;		//[elements + N]
+
+	Problem();
+	~Problem();
+
+	/** \brief Bytes of y, x and space (rows borrowed by a subset are not counted) */
+	size_t bytes() const;
+
+private:
+	// prevent copying and assignment: the problem owns its arrays; not implemented
+	Problem(const Problem &);
+	Problem& operator=(const Problem &);
+};
+
+/** \brief Reads a libsvm text file, or a binary dataset written by svm_gen -b (see dataset.h)
+ * 	\return 0 on success, 1 on a malformed file
+ */
+int read_problem(const char *filename, Problem *prob);
+
+/** \brief Writes prob as libsvm text with precision significant digits, or as a binary dataset
+ * 	\throws std::runtime_error if the file can't be written
+ */
+void write_problem(const char *filename, const Problem &prob, bool binary, int precision);
+
+/** \brief Makes out a problem of the given rows of prob, e.g. the folds of cross validation
+ *
+ * 	out copies the labels but its rows point into prob's storage, so prob must
+ * 	outlive it.
+ */
+void subset_problem(const Problem &prob, const std::vector<int> &rows, Problem *out);
+
+/** \brief Expands the rows of prob into a row-major dense matrix
+ * 	\param space set to the length * features block backing the rows; the caller frees it
+ * 	unless it comes from block
+ * 	\param pool if not NULL, each of its threads writes (and so places) its ThreadPool::range() chunk
+ * 	\param block if not NULL, allocated as pages asks to hold space
+ * 	\return Row pointers into space; the caller frees them
+ */
+double **densify(const Problem &prob, double **space, ThreadPool *pool = NULL, PageBlock *block = NULL,
+		PageMode pages = PAGES_MALLOC);
+
+/** \brief Parses one libsvm record ("label index:value ...") for streaming input
+ * 	\param line the record; it is modified
+ * 	\param row set to the features, terminated by index -1
+ * 	\return 0 on success, 1 on a malformed record
+ */
+int parse_record(char *line, double *label, std::vector<Feature> *row);
+
+/** \brief Dot product of two sparse rows */
+inline double dot(const Feature *a, const Feature *b)
+{
+	double sum = 0;
+	while (a->index != -1 && b->index != -1)
+	{
+		if (a->index == b->index)
+		{
+			sum += (a++)->value * (b++)->value;
+		}
+		else if (a->index < b->index)
+		{
+			++a;
+		}
+		else
+		{
+			++b;
+		}
+	}
+	return sum;
+}
+
+/** \brief |a - b|^2 of two sparse rows */
+inline double distance(const Feature *a, const Feature *b)
+{
+	double sum = 0;
+	while (a->index != -1 || b->index != -1)
+	{
+		double d;
+		if (a->index == b->index)
+		{
+			d = (a++)->value - (b++)->value;
+		}
+		else if (b->index == -1 || (a->index != -1 && a->index < b->index))
+		{
+			d = (a++)->value;
+		}
+		else
+		{
+			d = (b++)->value;
+		}
+		sum += d * d;
+	}
+	return sum;
+}
+
+/** \brief Dot product of a sparse row with a dense vector of at least the row's largest index */
+inline double dot(const Feature *row, const double *w)
+{
+	double sum = 0;
+	for (; row->index != -1; ++row)
+	{
+		sum += w[row->index - 1] * row->value;
+	}
+	return sum;
+}
+
+}
+; // namespace
+#endif
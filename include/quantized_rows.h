@@ -0,0 +1,79 @@
+/** @file quantized_rows.h
+ * @brief An int8 copy of the dense training rows for the SMO kernel
+ *
+ * Feature j is stored as q_ij = round(x_ij / s_j) with s_j = max_i |x_ij| / 127,
+ * one byte instead of eight, so a kernel evaluation streams an eighth of the
+ * memory. Dot products are taken on the integers and scaled back:
+ *
+ *	<x_i, x_k> ~ sum_j s_j^2 q_ij q_kj
+ *
+ * When every feature has the same scale (data scaled to [-1, 1], as is
+ * common) the sum stays in int32 lanes, through VNNI (vpdpbusd) where the
+ * CPU has it and AVX2 (vpmaddwd) otherwise, and is scaled once at the end.
+ * Otherwise the int16 products are converted and accumulated in floats
+ * with the weights s_j^2 (AVX2 with FMA). The kernel is chosen at run time;
+ * the scalar loop covers any other CPU. Rows are padded with zeros to 64
+ * bytes, so the vector loops have no tails, and |x_i|^2 is kept from the
+ * same dot product, so that the RBF distance of a row to itself is 0.
+ */
+#ifndef _QUANTIZED_ROWS_H
+#define _QUANTIZED_ROWS_H
+
+#include <stdint.h>
+#include <arena.h>
+
+namespace MySVM {
+
+class QuantizedRows {
+public:
+	QuantizedRows();
+
+	/**	\brief Quantizes the length dense rows of x
+	 * 	\throws std::bad_alloc if they don't fit
+	 */
+	void build(double *const *x, int length, int features);
+
+	/** \brief <x_i, x_k> of the quantized rows */
+	double dot(int i, int k) const { return dot_(*this, i, k); }
+
+	/** \brief |x_i|^2 of the quantized row */
+	double norm(int i) const { return norm_[i]; }
+
+	/** \brief Bytes of the quantized rows and their scales, norms and sums */
+	size_t bytes() const { return arena_.bytes(); }
+
+	/** \brief Name of the dot product kernel in use: avx-vnni, avx512-vnni, avx2, avx2-fma or scalar */
+	const char *kernelName() const { return kernelName_; }
+
+	int length;
+	int features;
+	int stride;			///< bytes per row, a multiple of 64
+	bool uniform;		///< one scale for every feature, integer accumulation
+	double scale;		///< the common scale if uniform
+	double maxError;	///< largest |x_ij - s_j q_ij|
+
+private:
+	typedef double (*DotFn)(const QuantizedRows &rows, int i, int k);
+
+	static double dotScalar(const QuantizedRows &rows, int i, int k);
+	static double dotAvx2(const QuantizedRows &rows, int i, int k);
+	static double dotAvx2Fma(const QuantizedRows &rows, int i, int k);
+	static double dotAvxVnni(const QuantizedRows &rows, int i, int k);
+	static double dotAvx512Vnni(const QuantizedRows &rows, int i, int k);
+
+	const int8_t *data_;	//[length][stride]
+	const float *weight_;	//[stride], s_j^2, 0 in the padding
+	const int32_t *sum_;	//[length], sum_j q_ij, for the unsigned operand of vpdpbusd
+	const double *norm_;	//[length]
+	DotFn dot_;
+	const char *kernelName_;
+	Arena arena_;
+
+	// prevent copying and assignment; not implemented
+	QuantizedRows(const QuantizedRows &);
+	QuantizedRows& operator=(const QuantizedRows &);
+};
+
+}
+; // namespace
+#endif
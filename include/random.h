@@ -0,0 +1,119 @@
+/** @file random.h
+ * @brief Small seedable random number generator for the solvers
+ *
+ * xoshiro256** (Blackman and Vigna), seeded through splitmix64. Every
+ * generator is an explicit object, so solvers and threads never share hidden
+ * state, and a (seed, stream) pair always replays the same sequence: parallel
+ * code derives one stream per unit of work (e.g. per pass and candidate)
+ * rather than per thread, which keeps results independent of the thread count.
+ */
+#ifndef _RANDOM_H
+#define _RANDOM_H
+
+#include <stdint.h>
+
+namespace MySVM {
+
+class Random {
+public:
+	/** \brief Starts the sequence identified by seed and stream */
+	explicit Random(uint64_t seed = 1, uint64_t stream = 0)
+	{
+		this->seed(seed, stream);
+	}
+
+	void seed(uint64_t seed, uint64_t stream = 0)
+	{
+		// streams are decorrelated by running them through splitmix64 as well
+		uint64_t x = seed ^ splitmix(stream);
+		for (int k = 0; k < 4; k++)
+		{
+			s_[k] = splitmix(x);
+		}
+	}
+
+	uint64_t next()
+	{
+		uint64_t result = rotl(s_[1] * 5, 7) * 9;
+		uint64_t t = s_[1] << 17;
+		s_[2] ^= s_[0];
+		s_[3] ^= s_[1];
+		s_[1] ^= s_[2];
+		s_[0] ^= s_[3];
+		s_[2] ^= t;
+		s_[3] = rotl(s_[3], 45);
+		return result;
+	}
+
+	/** \brief Copies the generator state out, e.g. into a checkpoint */
+	void state(uint64_t s[4]) const
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			s[k] = s_[k];
+		}
+	}
+
+	/** \brief Continues the sequence from a state saved by state() */
+	void restore(const uint64_t s[4])
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			s_[k] = s[k];
+		}
+	}
+
+	/** \brief Uniform integer in [0, n), n > 0 (Lemire's multiply and reject) */
+	uint32_t below(uint32_t n)
+	{
+		uint64_t m = (uint64_t) (uint32_t) (next() >> 32) * n;
+		if ((uint32_t) m < n)
+		{
+			uint32_t threshold = -n % n;
+			while ((uint32_t) m < threshold)
+			{
+				m = (uint64_t) (uint32_t) (next() >> 32) * n;
+			}
+		}
+		return (uint32_t) (m >> 32);
+	}
+
+	/** \brief Uniform double in [0, 1) */
+	double uniform()
+	{
+		return (next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	/** \brief Fisher-Yates shuffle of a[0, n) */
+	template<class T>
+	void shuffle(T *a, long n)
+	{
+		for (long i = n - 1; i > 0; i--)
+		{
+			long k = below((uint32_t) (i + 1));
+			T temp = a[i];
+			a[i] = a[k];
+			a[k] = temp;
+		}
+	}
+
+private:
+	static uint64_t rotl(uint64_t x, int k)
+	{
+		return (x << k) | (x >> (64 - k));
+	}
+
+	static uint64_t splitmix(uint64_t &x)
+	{
+		uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	uint64_t s_[4];
+};
+
+}
+; // namespace
+#endif
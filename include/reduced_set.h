@@ -0,0 +1,33 @@
+/** @file reduced_set.h
+ * @brief Shrinking the expansion of a trained RBF model to a budget of vectors
+ *
+ * Prediction costs one kernel evaluation per support vector, so a model is
+ * approximated by one with at most `budget` basis vectors by merging pairs,
+ * as in the budget maintenance of Wang, Crammer and Vucetic ("Breaking the
+ * Curse of Kernelization", JMLR 2012). The vector m with the smallest |coef|
+ * is merged with the partner n of the same sign that changes the expansion
+ * least: alpha_m phi(x_m) + alpha_n phi(x_n) is replaced by alpha_z phi(z),
+ * z = h x_m + (1 - h) x_n, where for the RBF kernel the best h in [0, 1]
+ * only depends on alpha_m / (alpha_m + alpha_n) and K(x_m, x_n); the error in
+ * feature space is alpha_m^2 + alpha_n^2 + 2 alpha_m alpha_n K(x_m, x_n) - alpha_z^2.
+ * As in that paper, the partners are ranked on a precomputed table of
+ * alpha_z over those two, and only the chosen merge is solved by golden
+ * section search.
+ * A vector without a partner of its sign is dropped. The threshold is kept.
+ */
+#ifndef _REDUCED_SET_H
+#define _REDUCED_SET_H
+
+#include <model.h>
+
+namespace MySVM {
+
+/**	\brief Merges the support vectors of an RBF model until at most budget are left
+ * 	\param error if not NULL, set to the summed squared error in feature space of the merges
+ * 	\return Number of support vectors removed
+ */
+int reduce_model(Model *model, int budget, double *error);
+
+}
+; // namespace
+#endif
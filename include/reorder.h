@@ -0,0 +1,35 @@
+/** @file reorder.h
+ * @brief Orders of the training rows that keep similar rows next to each other
+ *
+ * SMO spends its time in kernel columns and error updates over all rows and
+ * in passes over the non-bound rows, which end up scattered through the
+ * dense copy of the data. Placing rows that behave alike side by side (same
+ * label and norm, or same cluster) keeps the rows touched together in the
+ * same pages and cache lines. The order is a permutation: row k of the
+ * reordered problem is row rows[k] of the input, so results can be mapped
+ * back to the input order.
+ */
+#ifndef _REORDER_H
+#define _REORDER_H
+
+#include <vector>
+#include <stdint.h>
+#include <problem.h>
+
+namespace MySVM {
+
+enum RowOrder {
+	ORDER_NONE,		///< input order
+	ORDER_LABEL,	///< by label, then by |x|^2
+	ORDER_CLUSTER	///< by k-means cluster, then by label and |x|^2
+};
+
+/**	\brief Computes the permutation of the rows of prob for order
+ * 	\param seed picks the initial cluster centers
+ * 	\param rows set to the input row placed at each position
+ */
+void order_rows(const Problem &prob, RowOrder order, uint64_t seed, std::vector<int> *rows);
+
+}
+; // namespace
+#endif
@@ -0,0 +1,64 @@
+/** @file sgd_solver.h
+ * @brief Mini-batch Pegasos (stochastic primal) solver for linear SVMs on sparse rows
+ *
+ * Shalev-Shwartz et al., "Pegasos: Primal Estimated sub-GrAdient SOlver for
+ * SVM", 2007/2011, on min lambda/2 |w|^2 + 1/N sum_i max(0, 1 - y_i <w, x_i>).
+ * With eta_t = 1 / (lambda t) the step t = 1, 2, ... update
+ *
+ *	w_{t + 1} = (1 - eta_t lambda) w_t + eta_t / k sum_{violators i of w_t} y_i x_i
+ *
+ * telescopes into w_{t + 1} = v / t with v += y_i x_i / (lambda k) for every
+ * violator (w_1 = 0, so the first step takes every row of its batch), so
+ * the regularization never touches w and each step costs only the nonzeros
+ * of its batch. The returned weights are the average of the iterates
+ * after the first epoch, accumulated with the same lazy trick (the weights of
+ * an update are a difference of harmonic numbers).
+ *
+ * With several threads, each runs its own batches against the shared v
+ * without locks, Hogwild style (Niu et al., 2011): v is read with relaxed
+ * atomic loads and added to with relaxed compare-and-swap, so no update is
+ * lost, but a batch may score its rows against a v that other threads are
+ * still changing.
+ * As in the other linear engines, the threshold is the weight of a constant
+ * feature, b = -w_0.
+ */
+#ifndef _SGD_SOLVER_H
+#define _SGD_SOLVER_H
+
+#include <vector>
+#include <problem.h>
+#include <random.h>
+
+namespace MySVM {
+
+class SGDSolver {
+public:
+	std::vector<double> w;	//[M], averaged
+	double b;				///< threshold, f(x) = <w, x> - b
+	uint64_t seed;			///< seeds the order of the rows in each epoch
+
+	/**	\brief Sets up a solver over prob's rows; prob must outlive it */
+	explicit SGDSolver(const Problem &prob);
+
+	/**	\brief Runs epochs passes over the data in random mini-batches
+	 * 	\param lambda regularization; 1 / (C N) matches a C-SVM
+	 * 	\param epochs passes; with none (or no rows) no step is taken and w and b stay at 0
+	 * 	\param batch rows per step
+	 * 	\param threads Hogwild threads; results vary slightly with more than one
+	 * 	\return Number of steps taken
+	 */
+	long train(double lambda, int epochs, int batch, int threads);
+
+	/**	\brief Primal C-SVM objective 1/2 (|w|^2 + b^2) + cost sum_i max(0, 1 - y_i f(x_i)) */
+	double objective(double cost) const;
+
+	/** \brief Fraction of the training rows on the right side of the hyperplane */
+	double accuracy() const;
+
+private:
+	const Problem &prob_;
+};
+
+}
+; // namespace
+#endif
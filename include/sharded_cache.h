@@ -0,0 +1,241 @@
+/**
+ * @file sharded_cache.h Thread safe LRU cache with per-shard locking
+ * @par
+ * Keys are hashed onto a fixed number of independently locked shards, each of
+ * which is a small LRU cache with its own share of the size budget.  Threads
+ * touching different shards never contend, and the lock of a shard is only
+ * held for the index lookup and the list splice: cached values are stored
+ * behind a std::shared_ptr, so copying the data out of the cache happens
+ * after the lock has been released and cannot race with an eviction.
+ *
+ * @par
+ * Recency is tracked per shard, so eviction is LRU within a shard and only
+ * approximately LRU across the whole cache.
+ */
+#ifndef _SHARDED_CACHE_H
+#define _SHARDED_CACHE_H
+
+#include <list>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <cache.h>
+
+/**
+ * @brief Template cache with a per-shard LRU removal policy.
+ * @class ShardedLRUCache
+ *
+ * @par
+ * Same interface as LRUCache, with Size split evenly between the shards.
+ */
+template< class Key, class Data, class Sizefn = Countfn< Data >, class Hash = std::hash< Key > >
+class ShardedLRUCache {
+	public:
+		typedef std::shared_ptr< const Data > Data_Ptr;           ///< Shared handle to cached data
+		typedef std::list< std::pair< Key, Data_Ptr > > List;     ///< Shard storage typedef
+		typedef typename List::iterator List_Iter;                ///< Shard storage iterator
+		typedef std::unordered_map< Key, List_Iter, Hash > Map;   ///< Shard index typedef
+		typedef typename Map::iterator Map_Iter;                  ///< Shard index iterator
+		typedef std::vector< Key > Key_List;                      ///< List of keys
+
+	private:
+		/// One independently locked LRU list, padded to its own cache lines.
+		struct alignas( 64 ) Shard {
+			std::mutex mutex;          ///< Guards everything below
+			List list;                 ///< Most recently used at the front
+			Map index;                 ///< Key to list position
+			unsigned long max_size;    ///< Share of the abstract size budget
+			unsigned long curr_size;   ///< Current abstract size of the shard
+		};
+
+		std::vector< Shard > _shards;
+
+	public:
+
+		/** @brief Creates a cache that holds at most Size worth of elements.
+		 *  @param Size maximum size of cache, split evenly between the shards
+		 *  @param Shards number of independently locked shards
+		 */
+		ShardedLRUCache( const unsigned long Size, const unsigned int Shards = 16 ) :
+				_shards( Shards > 0 ? Shards : 1 ) {
+			for( size_t s = 0; s < _shards.size(); s++ ) {
+				_shards[s].max_size = Size / _shards.size() + ( s < Size % _shards.size() ? 1 : 0 );
+				_shards[s].curr_size = 0;
+			}
+		}
+
+		/// Destructor - cleans up both index and storage
+		~ShardedLRUCache() { clear(); }
+
+		/** @brief Gets the number of shards.
+		 *  @return shard count
+		 */
+		inline unsigned int shards( void ) const { return _shards.size(); }
+
+		/** @brief Gets the current abstract size of the cache.
+		 *  @return current size, summed over the shards
+		 */
+		unsigned long size( void ) {
+			unsigned long total = 0;
+			for( size_t s = 0; s < _shards.size(); s++ ) {
+				std::lock_guard< std::mutex > lock( _shards[s].mutex );
+				total += _shards[s].curr_size;
+			}
+			return total;
+		}
+
+		/** @brief Gets the maximum abstract size of the cache.
+		 *  @return maximum size
+		 */
+		unsigned long max_size( void ) const {
+			unsigned long total = 0;
+			for( size_t s = 0; s < _shards.size(); s++ )
+				total += _shards[s].max_size;
+			return total;
+		}
+
+		/// Clears all storage and indices.
+		void clear( void ) {
+			for( size_t s = 0; s < _shards.size(); s++ ) {
+				std::lock_guard< std::mutex > lock( _shards[s].mutex );
+				_shards[s].list.clear();
+				_shards[s].index.clear();
+				_shards[s].curr_size = 0;
+			}
+		}
+
+		/** @brief Checks for the existance of a key in the cache.
+		 *  @param key to check for
+		 *  @return bool indicating whether or not the key was found.
+		 */
+		inline bool exists( const Key &key ) {
+			Shard &shard = _shard( key );
+			std::lock_guard< std::mutex > lock( shard.mutex );
+			return shard.index.find( key ) != shard.index.end();
+		}
+
+		/** @brief Removes a key-data pair from the cache.
+		 *  @param key to be removed
+		 */
+		inline void remove( const Key &key ) {
+			Shard &shard = _shard( key );
+			std::lock_guard< std::mutex > lock( shard.mutex );
+			Map_Iter miter = shard.index.find( key );
+			if( miter == shard.index.end() ) return;
+			_remove( shard, miter );
+		}
+
+		/** @brief Touches a key in the Cache and makes it the most recently used.
+		 *  @param key to be touched
+		 */
+		inline void touch( const Key &key ) {
+			Shard &shard = _shard( key );
+			std::lock_guard< std::mutex > lock( shard.mutex );
+			Map_Iter miter = shard.index.find( key );
+			if( miter != shard.index.end() )
+				shard.list.splice( shard.list.begin(), shard.list, miter->second );
+		}
+
+		/** @brief Fetches a shared handle to cached data.
+		 *  @param key to fetch data for
+		 *  @param touch_data whether or not to touch the data
+		 *  @return handle to the data, which stays valid after eviction, or an empty handle
+		 */
+		inline Data_Ptr fetch_shared( const Key &key, bool touch_data = true ) {
+			Shard &shard = _shard( key );
+			std::lock_guard< std::mutex > lock( shard.mutex );
+			Map_Iter miter = shard.index.find( key );
+			if( miter == shard.index.end() ) return Data_Ptr();
+			if( touch_data )
+				shard.list.splice( shard.list.begin(), shard.list, miter->second );
+			return miter->second->second;
+		}
+
+		/** @brief Fetches a copy of cached data.
+		 *  @param key to fetch data for
+		 *  @param touch_data whether or not to touch the data
+		 *  @return copy of the data or an empty Data object if not found
+		 */
+		inline Data fetch( const Key &key, bool touch_data = true ) {
+			Data_Ptr ptr = fetch_shared( key, touch_data );
+			return ptr ? *ptr : Data();
+		}
+
+		/** @brief Fetches a copy of cached data; the copy is made outside the shard lock.
+		 *  @param key to fetch data for
+		 *  @param data to fetch data into
+		 *  @param touch_data whether or not to touch the data
+		 *  @return whether or not data was filled in
+		 */
+		inline bool fetch( const Key &key, Data &data, bool touch_data = true ) {
+			Data_Ptr ptr = fetch_shared( key, touch_data );
+			if( !ptr ) return false;
+			data = *ptr;
+			return true;
+		}
+
+		/** @brief Inserts a key-data pair into the cache and removes entries if neccessary.
+		 *  @param key object key for insertion
+		 *  @param data object data for insertion
+		 *  @note The copy of data is made before the shard lock is taken.
+		 */
+		inline void insert( const Key &key, const Data &data ) {
+			Data_Ptr ptr = std::make_shared< const Data >( data );
+			unsigned long data_size = Sizefn()( data );
+
+			Shard &shard = _shard( key );
+			std::lock_guard< std::mutex > lock( shard.mutex );
+			Map_Iter miter = shard.index.find( key );
+			if( miter != shard.index.end() )
+				_remove( shard, miter );
+
+			shard.list.push_front( std::make_pair( key, ptr ) );
+			shard.index.insert( std::make_pair( key, shard.list.begin() ) );
+			shard.curr_size += data_size;
+
+			// Check to see if we need to remove elements due to exceeding the shard's max_size
+			while( shard.curr_size > shard.max_size && !shard.list.empty() ) {
+				List_Iter liter = shard.list.end();
+				--liter;
+				_remove( shard, shard.index.find( liter->first ) );
+			}
+		}
+
+		/** @brief Get a list of keys.
+				@return list of the current keys, grouped by shard.
+		*/
+		inline const Key_List get_all_keys( void ) {
+			Key_List ret;
+			for( size_t s = 0; s < _shards.size(); s++ ) {
+				std::lock_guard< std::mutex > lock( _shards[s].mutex );
+				for( List_Iter liter = _shards[s].list.begin(); liter != _shards[s].list.end(); liter++ )
+					ret.push_back( liter->first );
+			}
+			return ret;
+		}
+
+	private:
+		/** @brief Maps a key onto its shard.
+		 *  @param key to look up
+		 *  @return the shard owning key
+		 */
+		inline Shard &_shard( const Key &key ) {
+			// Fibonacci mixing, so that sequential integer keys spread over the shards
+			unsigned long long h = (unsigned long long) Hash()( key ) * 0x9E3779B97F4A7C15ULL;
+			return _shards[ ( h >> 32 ) % _shards.size() ];
+		}
+
+		/** @brief Interal remove function, called with the shard lock held
+		 *  @param shard owning the entry
+		 *  @param miter Map_Iter that points to the key to remove
+		 */
+		inline void _remove( Shard &shard, const Map_Iter &miter ) {
+			shard.curr_size -= Sizefn()( *miter->second->second );
+			shard.list.erase( miter->second );
+			shard.index.erase( miter );
+		}
+};
+
+#endif
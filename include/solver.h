@@ -8,13 +8,65 @@
 #define _SOLVER_H 
 
 #include <time.h>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <arena.h>
 #include <cache.h>
+#include <kernel_cache.h>
+#include <thread_pool.h>
+#include <random.h>
+#include <quantized_rows.h>
 
 #define C 2
 #define EPS 0.01
+#define CACHE_SIZE 100 // kernel column cache budget in MB
 
 namespace MySVM {
 
+/** \brief Kernel functions understood by Solver::kernel() */
+enum KernelType {
+	KERNEL_LINEAR,	///< <x_i, x_j>; w is maintained and the errors are computed from it
+	KERNEL_RBF		///< exp(-gamma |x_i - x_j|^2); the errors are updated from cached kernel rows
+};
+
+/** \brief A proposed joint update of one pair of alphas, as computed by Solver::step() */
+struct Step {
+	int index_i;
+	int index_j;
+	double alpha_i;	///< new value of alpha[index_i]
+	double alpha_j;	///< new value of alpha[index_j]
+	double delta_i;	///< y[index_i] * (change of alpha[index_i])
+	double delta_j;	///< y[index_j] * (change of alpha[index_j])
+	double b;		///< new threshold
+	double gain;	///< increase of the dual objective
+};
+
+/** \brief Where the outer loop of training stands, so that a checkpointed run can carry on */
+struct LoopState {
+	int passes;			///< passes started
+	int index;			///< next row of the current pass to examine
+	int numChanged;		///< pairs changed so far in the current pass
+	bool examineAll;	///< the current pass examines every row, not only the non-bound ones
+};
+
+/** \brief Convergence measures of the current iterate, as reported by Solver::measure() */
+struct Progress {
+	int passes;
+	int index;				///< next row of the current pass
+	unsigned long updates;
+	double seconds;			///< since training started
+	double dual;			///< sum(alpha) - 1/2 |w|^2, tracked by commit()
+	double primal;			///< 1/2 |w|^2 + C sum max(0, 1 - y_i (f(x_i) - b)) at the current b
+	double gap;				///< primal - dual, >= 0; 0 at the optimum
+	double violation;		///< KKT violation of the most violating pair, independent of b; 0 at the optimum
+	int supportVectors;
+	int boundVectors;		///< alphas at C
+};
+
+class Checkpointer;
+struct BatchColumn;
+
 class Solver {
 private:
 	/** \brief 'TakeStep' Optimize the SVM for a pair of alphas
@@ -24,16 +76,57 @@ private:
 	 */
 	int update(int index_i, int index_j);
 
+	/** \brief examine() against the current state without changing it, for the parallel sweep
+	 * 	\param nonBoundIdx indices of the non-bound alphas
+	 * 	\param slot, slots the second choice heuristic only considers nonBoundIdx[slot::slots]
+	 * 	\param rng generator for the random starting points
+	 * 	\return Whether a step that makes progress was found
+	 */
+	bool propose(int index_j, const std::vector<int> &nonBoundIdx, int slot, int slots,
+			Random &rng, Step *out) const;
+
+	/** \brief K(col.index, row), from the column if it is already filled, else evaluated */
+	double columnEntry(const BatchColumn &col, int row) const;
+
 public:
 	double *y;		//[N];
 	double **x;		//[N][M];
-	double *alpha; 	//[N]
-	double *w; 		//[M]
+	double *alpha; 	//[N], in the arena
+	double *w; 		//[M], in the arena
 	double b;
-	double *error; 	//[N];
+	double *error; 	//[N], in the arena
 	double length;
 	double features;
-	int *randi;
+	int *randi;		//[N], in the arena
+	std::unique_ptr<KernelCache> cache;
+	KernelType kernelType;
+	double gamma;	///< width of the RBF kernel
+	unsigned long updates;	///< pairs committed
+	bool lazyErrors;	///< update() keeps only the non-bound errors current, see currentError()
+	uint64_t seed;		///< seeds every random choice of the solver; applied by init()
+	double tolerance;	///< KKT violations up to this much are accepted, EPS by default
+	LoopState loop;		///< reset by init(), restored from a checkpoint to resume
+	double dual;		///< dual objective of alpha, kept current by commit()
+
+	// stopping criteria besides convergence, checked by the training loops; 0 disables each
+	double maxGap;				///< stop once the duality gap is at most maxGap |primal|
+	double maxSeconds;			///< stop after this much training time
+	unsigned long maxUpdates;	///< stop after this many pairs
+	const char *stopReason;		///< why training ended: converged, gap, time or updates
+
+	/** \brief Receives a Progress at the end of every pass and every progressInterval seconds within one */
+	std::function<void(const Progress &)> progress;
+	double progressInterval;
+	Checkpointer *checkpointer;	///< if not NULL, snapshots are saved when it says they are due
+	const int *order;	///< input row of each row when the rows were reordered (see reorder.h), or NULL
+	std::vector<int> cpus;	///< cpu of each thread of trainParallel() (see numa.h), empty to leave them unpinned
+	PageMode pages;		///< backing of the arena and the kernel cache (see huge_pages.h), applied by init()
+	const QuantizedRows *quantized;	///< if not NULL, kernel() takes its dot products from these int8 rows
+
+	// examine()'s last resort, the sweep over all rows from a random start
+	unsigned long sweeps;		///< sweeps started
+	unsigned long sweepTries;	///< update() attempts made by them
+	double sweepSeconds;		///< time spent in them
 
 	/** \brief 'ExamineExample' Checks if SVM structure satisfies KKT conditions; If for a given index the conditions are not met, calls update() to optimize for current alpha pair
 	 * 	\param index index to check
@@ -42,16 +135,133 @@ public:
 	int examine(int index);
 
 	/**	\brief Evaluates the kernel function on two inputs
+	 *
+	 * 	With quantized rows set, x is not read: the dot product and the norms
+	 * 	come from the int8 copy.
 	 * 	\return Evaluated dot product
 	 */
-	double kernel(double* x[] , int, int);
+	double kernel(double* x[] , int, int) const;
+
+	/**	\brief Error of index from the weight vector, <w, x_index> - b - y_index; linear kernel only */
+	double linearError(int index) const;
+
+	/**	\brief Fetches K(index, r) for every row r from the kernel cache, computing it on a miss
+	 * 	\return Column of length values, valid until the next two kernelRow() calls
+	 */
+	double *kernelRow(int index);
+
+	/** \brief Computes the pair update for the given errors without changing any state
+	 * 	\param E1 error of index_i to use
+	 * 	\param E2 error of index_j to use
+	 * 	\param out the proposed step, filled in when the step makes progress
+	 * 	\return Whether the step makes progress
+	 */
+	bool step(int index_i, int index_j, double E1, double E2, Step *out) const;
+
+	/** \brief Applies a step to alpha, b and (for the linear kernel) w; the error cache is left to the caller */
+	void commit(const Step &step);
+
+	/**	\brief error[index], first brought up to date if the lazy error cache let it fall behind
+	 *
+	 * 	A stale error is recomputed from w for the linear kernel, or otherwise
+	 * 	advanced by the alpha deltas of the steps committed since it was last
+	 * 	current (two kernel evaluations per step) and the change of b.
+	 */
+	double currentError(int index);
+
+	/**	\brief Brings every error up to date and starts a new step history */
+	void syncErrors();
+
+	/**	\brief Whether alpha[index] lies strictly between the bounds 0 and C */
+	bool nonBound(int index) const;
+
+	/**	\brief Runs the SMO outer loop until a full pass changes nothing
+	 *
+	 * 	Starts from loop, so a restored checkpoint continues with the row after
+	 * 	the one it was taken at.
+	 * 	\return Number of passes over the data, those before a resume included
+	 */
+	int train();
+
+	/**	\brief Parallel SMO outer loop
+	 *
+	 * 	Each batch of a randomized sweep is examined by several threads against
+	 * 	a snapshot, disjoint pairs are committed in order with their errors
+	 * 	corrected for the earlier commits of the batch, and the error cache
+	 * 	deltas of all committed pairs are merged in one parallel pass. Batches
+	 * 	have a fixed size and each candidate draws from its own random stream,
+	 * 	so the result does not depend on the number of threads. Checkpoints are
+	 * 	taken as a pass starts; resuming repeats the pass the checkpoint is from.
+	 * 	\param threads number of threads
+	 * 	\return Number of passes over the data
+	 */
+	int trainParallel(int threads);
+
+	/**	\brief Fills out from the error cache in one pass over the rows; brings a lazy error cache up to date first */
+	void measure(Progress *out);
+
+	/**	\brief Dual objective sum(alpha) - 1/2 sum_ij alpha_i alpha_j y_i y_j K(i, j), from the error cache */
+	double objective() const;
+
+	/**	\brief Allocates alpha, error, randi, w and the kernel cache for length rows; all alphas start at 0
+	 *
+	 * 	The arrays share one arena, which replaces the previous one on a new init().
+	 * 	\param cacheBytes kernel cache budget; 0 leaves the solver without a cache, for
+	 * 	callers that only use kernel(), step() and commit() (see distributed.h)
+	 * 	\param pool if not NULL, the per-row arrays are first written by its threads, each
+	 * 	over its ThreadPool::range() chunk, which places them like the rows (see numa.h)
+	 */
+	void init(unsigned long cacheBytes, ThreadPool *pool = NULL);
+
+	/**	\brief Bytes of solver state besides the kernel cache: the arena and the step history */
+	size_t stateBytes() const;
+
+	/**	\brief How much of the arena is on huge pages */
+	PageUsage stateUsage() const { return arena_.usage(); }
+
+	/**	\brief Recomputes w and the error cache from the current alpha and b, e.g. after a warm start
+	 * 	\param pool threads to spread the rows over, or NULL
+	 */
+	void recompute(ThreadPool *pool);
 
 	Solver();
+	~Solver();
+	/** \brief Fills A with a random permutation of [0, n), from the solver's generator */
 	void randperm( int*, int);
 	void print();
 
+private:
+	// lazy error cache: steps committed since the last syncErrors(), the
+	// history length at which each error was last current, and b at that point
+	std::vector<Step> history;
+	size_t *stamp;	//[N], in the arena
+	double historyB;
+
+	Arena arena_;
+
+	Random rng;
+
+	// when a criterion or progress is set, the training loops call watch() every
+	// 64 rows and at the end of each pass; it emits progress and tells them to
+	// stop when a criterion is met
+	bool watch(bool passEnd);
+	double started_;		///< clock at the start of the training loop
+	double reported_;		///< clock at the last progress event
+
+	friend class Checkpointer;
+
+	// prevent copying and assignment: the solver owns its state arrays; not implemented
+	Solver(const Solver &);
+	Solver& operator=(const Solver &);
+
 };// end Solver
 
+/**	\brief Fills the dual, primal, gap, violation and vector counts of out from an error cache
+ * 	\param dual the dual objective, as tracked by commit()
+ */
+void measure_errors(int length, const double *y, const double *alpha, const double *error, double b,
+		double dual, Progress *out);
+
 }
 ;// namespace
 #endif
@@ -0,0 +1,72 @@
+/** @file thread_pool.h
+ * @brief Persistent worker threads for the parallel solver loops
+ */
+#ifndef _THREAD_POOL_H
+#define _THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+#include <sched.h>
+
+namespace MySVM {
+
+/**
+ * \brief Fixed set of threads that repeatedly run one job to completion
+ *
+ * The parallel SMO loop runs two short phases per batch, so threads are
+ * created once and woken per job instead of being spawned per batch.
+ * Thread t always gets the same chunk from range(), so with the threads
+ * pinned (see numa.h) a chunk first written by its thread stays local.
+ */
+class ThreadPool {
+public:
+	typedef std::function<void(int, int)> Job;	///< called as job(thread, threads)
+
+	/**	\brief Starts threads - 1 workers; the calling thread acts as thread 0
+	 * 	\param cpus if not empty, thread t is pinned to cpus[t]; the calling thread
+	 * 	gets its previous affinity back when the pool is destroyed
+	 */
+	explicit ThreadPool(int threads, const std::vector<int> &cpus = std::vector<int>());
+	~ThreadPool();
+
+	/** \brief Number of threads taking part in each job */
+	int size() const { return threads_; }
+
+	/** \brief Runs job on every thread and returns once all of them have finished */
+	void run(const Job &job);
+
+	/** \brief Splits [0, n) into size() contiguous chunks and returns chunk thread's bounds */
+	static void range(long n, int thread, int threads, long *begin, long *end);
+
+	/** \brief 0 if every thread was pinned as asked, otherwise the errno of the first failure; settled once a job has run */
+	int pinError() const { return pinError_; }
+
+private:
+	void worker(int thread);
+	void pin(int thread);
+
+	int threads_;
+	std::vector<int> cpus_;
+	cpu_set_t callerAffinity_;
+	bool callerPinned_;
+	int pinError_;
+	std::vector<std::thread> workers_;
+	std::mutex mutex_;
+	std::condition_variable start_;
+	std::condition_variable done_;
+	const Job *job_;
+	unsigned long generation_;
+	int pending_;
+	bool stop_;
+
+	// prevent copying and assignment; not implemented
+	ThreadPool(const ThreadPool &);
+	ThreadPool& operator=(const ThreadPool &);
+};
+
+}
+; // namespace
+#endif
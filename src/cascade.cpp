@@ -0,0 +1,251 @@
+#include <mysvm.h>
+#include <cascade.h>
+#include <time.h>
+
+namespace MySVM
+{
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** \brief A subset of the rows of the full problem, with alphas to warm start from */
+struct Part
+{
+	std::vector<int> rows;
+	std::vector<double> alpha;
+	double b;
+};
+
+/** \brief Trains part's rows and leaves only the resulting support vectors in it
+ * 	\param deadline now() at which the time budget of the full solver runs out, 0 for none
+ * 	\param maxUpdates the share of the full solver's update budget left to it, 0 for none;
+ * 	the sub-solver stops at its own duality gap under full.maxGap too
+ * 	\param updates set to the pairs the sub-solver committed
+ * 	\return Number of passes of the sub-solver
+ */
+static int trainPart(const Solver &full, Part &part, unsigned long cacheBytes, double deadline,
+		unsigned long maxUpdates, unsigned long *updates)
+{
+	int n = part.rows.size();
+	*updates = 0;
+	if (n < 2)
+	{
+		return 0;
+	}
+
+	// the sub-solver shares the rows of the full problem, it only copies pointers and labels
+	std::vector<double *> x(n);
+	std::vector<double> y(n);
+	for (int k = 0; k < n; k++)
+	{
+		x[k] = full.x[part.rows[k]];
+		y[k] = full.y[part.rows[k]];
+	}
+
+	Solver sub;
+	sub.length = n;
+	sub.features = full.features;
+	sub.kernelType = full.kernelType;
+	sub.gamma = full.gamma;
+	sub.lazyErrors = full.lazyErrors;
+	sub.seed = full.seed;
+	sub.tolerance = full.tolerance;
+	sub.maxGap = full.maxGap;
+	sub.maxUpdates = maxUpdates;
+	sub.x = &x[0];
+	sub.y = &y[0];
+	sub.init(cacheBytes);
+
+	bool warm = false;
+	for (int k = 0; k < n; k++)
+	{
+		sub.alpha[k] = part.alpha[k];
+		warm = warm || part.alpha[k] > 0;
+	}
+	if (warm)
+	{
+		sub.b = part.b;
+		sub.recompute(NULL);
+	}
+
+	// the clock of train() starts after the setup above
+	sub.maxSeconds = (deadline > 0) ? std::max(deadline - now(), 1e-9) : 0;
+	int passes = sub.train();
+	*updates = sub.updates;
+
+	Part sv;
+	for (int k = 0; k < n; k++)
+	{
+		if (sub.alpha[k] > 0)
+		{
+			sv.rows.push_back(part.rows[k]);
+			sv.alpha.push_back(sub.alpha[k]);
+		}
+	}
+	sv.b = sub.b;
+	part = sv;
+	return passes;
+}
+
+int trainCascade(Solver &solver, int partitions, int threads, int maxRounds, int *rounds)
+{
+	double deadline = (solver.maxSeconds > 0) ? now() + solver.maxSeconds : 0;
+	ThreadPool pool(threads);
+	unsigned long cacheBytes = solver.cache->max_bytes() / pool.size();
+
+	// first layer: random, equally sized partitions
+	if (partitions < 1)
+	{
+		partitions = 1;
+	}
+	std::vector<Part> parts(partitions);
+	solver.randperm(solver.randi, solver.length);
+	for (int k = 0; k < solver.length; k++)
+	{
+		Part &part = parts[(long) k * partitions / (int) solver.length];
+		part.rows.push_back(solver.randi[k]);
+		part.alpha.push_back(0);
+		part.b = 0;
+	}
+
+	// the passes and pairs of every sub-solver count towards the totals, and towards
+	// the time and update budgets of the full solver
+	int passes = 0;
+	unsigned long updates = 0;
+	auto spent = [&]() -> const char *
+	{
+		if (solver.maxUpdates > 0 && updates >= solver.maxUpdates)
+		{
+			return "updates";
+		}
+		if (deadline > 0 && now() >= deadline)
+		{
+			return "time";
+		}
+		return NULL;
+	};
+	std::vector<int> partPasses;
+	std::vector<unsigned long> partUpdates;
+	for (;;)
+	{
+		partPasses.assign(parts.size(), 0);
+		partUpdates.assign(parts.size(), 0);
+		// the parts of a layer split the updates left between them
+		unsigned long maxUpdates = (solver.maxUpdates > 0)
+				? std::max((solver.maxUpdates - updates) / parts.size(), 1UL) : 0;
+		pool.run([&](int thread, int nthreads)
+		{
+			for (size_t k = thread; k < parts.size(); k += nthreads)
+			{
+				partPasses[k] = trainPart(solver, parts[k], cacheBytes, deadline, maxUpdates, &partUpdates[k]);
+			}
+		});
+		for (size_t k = 0; k < parts.size(); k++)
+		{
+			passes += partPasses[k];
+			updates += partUpdates[k];
+		}
+
+		if (parts.size() == 1)
+		{
+			break;
+		}
+		if (spent())
+		{
+			// no budget for the layers left: the parts keep sum y alpha = 0 each, so
+			// their union is a feasible start for the full problem
+			Part &all = parts[0];
+			for (size_t k = 1; k < parts.size(); k++)
+			{
+				all.rows.insert(all.rows.end(), parts[k].rows.begin(), parts[k].rows.end());
+				all.alpha.insert(all.alpha.end(), parts[k].alpha.begin(), parts[k].alpha.end());
+				all.b += parts[k].b;
+			}
+			all.b /= parts.size();
+			parts.resize(1);
+			break;
+		}
+
+		// merge the support vectors of neighbouring results
+		std::vector<Part> merged((parts.size() + 1) / 2);
+		for (size_t k = 0; k < parts.size(); k += 2)
+		{
+			Part &next = merged[k / 2];
+			next = parts[k];
+			if (k + 1 < parts.size())
+			{
+				Part &other = parts[k + 1];
+				next.rows.insert(next.rows.end(), other.rows.begin(), other.rows.end());
+				next.alpha.insert(next.alpha.end(), other.alpha.begin(), other.alpha.end());
+				next.b = (next.b + other.b) / 2;
+			}
+		}
+		parts.swap(merged);
+	}
+
+	// feedback: add the rows that violate the KKT conditions of the cascade's model
+	Part &last = parts[0];
+	*rounds = 0;
+	for (;;)
+	{
+		for (int i = 0; i < solver.length; i++)
+		{
+			solver.alpha[i] = 0;
+		}
+		for (size_t k = 0; k < last.rows.size(); k++)
+		{
+			solver.alpha[last.rows[k]] = last.alpha[k];
+		}
+		solver.b = last.b;
+		solver.recompute(&pool);
+
+		if (*rounds == maxRounds || spent())
+		{
+			break;
+		}
+
+		int violators = 0;
+		for (int i = 0; i < solver.length; i++)
+		{
+			// same test as examine(), for rows the cascade left at alpha = 0
+			if (solver.alpha[i] == 0 && solver.error[i] * solver.y[i] < -solver.tolerance)
+			{
+				last.rows.push_back(i);
+				last.alpha.push_back(0);
+				++violators;
+			}
+		}
+		if (violators == 0)
+		{
+			break;
+		}
+
+		unsigned long roundUpdates;
+		passes += trainPart(solver, last, solver.cache->max_bytes(), deadline,
+				solver.maxUpdates > 0 ? solver.maxUpdates - updates : 0, &roundUpdates);
+		updates += roundUpdates;
+		++(*rounds);
+	}
+
+	// the final pass adds its own pairs to solver.updates, and gets the time left
+	solver.updates += updates;
+	const char *reason = spent();
+	if (reason != NULL)
+	{
+		solver.stopReason = reason;
+		return passes;
+	}
+	double maxSeconds = solver.maxSeconds;
+	solver.maxSeconds = (deadline > 0) ? std::max(deadline - now(), 1e-9) : 0;
+	passes += solver.train();
+	solver.maxSeconds = maxSeconds;
+	return passes;
+}
+
+}
+;
+// namespace
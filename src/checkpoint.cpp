@@ -0,0 +1,222 @@
+#include <mysvm.h>
+#include <checkpoint.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace MySVM
+{
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t fnv(const void *data, size_t bytes, uint64_t h = 14695981039346656037ULL)
+{
+	const unsigned char *p = static_cast<const unsigned char *>(data);
+	for (size_t k = 0; k < bytes; k++)
+	{
+		h = (h ^ p[k]) * 1099511628211ULL;
+	}
+	return h;
+}
+
+/** \brief Hash of the labels and of up to 1024 rows spread over the problem, to tell problems apart */
+static uint64_t fingerprint(const Solver &solver)
+{
+	int rows = (int) solver.length;
+	size_t rowBytes = (size_t) solver.features * sizeof(double);
+	uint64_t h = fnv(solver.y, rows * sizeof(double));
+	int step = std::max(rows / 1024, 1);
+	for (int i = 0; i < rows; i += step)
+	{
+		h = fnv(solver.x[i], rowBytes, h);
+	}
+	return h;
+}
+
+Checkpointer::Checkpointer(const char *filename, double interval) :
+	written(0), superseded(0), failures(0), copySeconds(0), writeSeconds(0), bytes(0),
+	filename_(filename), interval_(interval), last_(now()), data_(0), ready_(-1), stop_(false)
+{
+	state_[0] = state_[1] = FREE;
+	thread_ = std::thread(&Checkpointer::writer, this);
+}
+
+Checkpointer::~Checkpointer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	wake_.notify_one();
+	thread_.join();
+}
+
+bool Checkpointer::due()
+{
+	return now() - last_ >= interval_;
+}
+
+void Checkpointer::save(Solver &solver)
+{
+	double start = now();
+	if (solver.lazyErrors)
+	{
+		solver.syncErrors();
+	}
+
+	// take the buffer the writer isn't using; a snapshot still waiting is superseded
+	int target;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (int k = 0; k < 2; k++)
+		{
+			if (state_[k] == READY)
+			{
+				state_[k] = FREE;
+				++superseded;
+			}
+		}
+		ready_ = -1;
+		target = (state_[0] == WRITING) ? 1 : 0;
+	}
+
+	size_t rows = (size_t) solver.length;
+	size_t features = (size_t) solver.features;
+	if (bytes == 0)
+	{
+		data_ = fingerprint(solver);
+	}
+	bytes = sizeof(CheckpointHeader) + (2 * rows + features) * sizeof(double);
+	std::vector<char> &buffer = buffers_[target];
+	buffer.resize(bytes);
+
+	CheckpointHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+	header.version = CHECKPOINT_VERSION;
+	header.kernel = solver.kernelType;
+	header.rows = rows;
+	header.features = features;
+	header.gamma = solver.gamma;
+	header.data = data_;
+	header.b = solver.b;
+	header.updates = solver.updates;
+	header.passes = solver.loop.passes;
+	header.index = solver.loop.index;
+	header.numChanged = solver.loop.numChanged;
+	header.examineAll = solver.loop.examineAll;
+	solver.rng.state(header.rng);
+
+	char *p = &buffer[sizeof(header)];
+	memcpy(p, solver.alpha, rows * sizeof(double));
+	memcpy(p + rows * sizeof(double), solver.error, rows * sizeof(double));
+	memcpy(p + 2 * rows * sizeof(double), solver.w, features * sizeof(double));
+	memcpy(&buffer[0], &header, sizeof(header));
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		state_[target] = READY;
+		ready_ = target;
+	}
+	wake_.notify_one();
+	last_ = now();
+	copySeconds += last_ - start;
+}
+
+void Checkpointer::wait()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	idle_.wait(lock, [this] { return ready_ < 0 && state_[0] != WRITING && state_[1] != WRITING; });
+}
+
+void Checkpointer::writer()
+{
+	std::string temp = filename_ + ".tmp";
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (;;)
+	{
+		wake_.wait(lock, [this] { return stop_ || ready_ >= 0; });
+		if (ready_ < 0)
+		{
+			break;
+		}
+		int k = ready_;
+		ready_ = -1;
+		state_[k] = WRITING;
+		lock.unlock();
+
+		// the checksum is computed here, off the training thread
+		double start = now();
+		std::vector<char> &buffer = buffers_[k];
+		CheckpointHeader *header = reinterpret_cast<CheckpointHeader *>(&buffer[0]);
+		header->checksum = fnv(&buffer[sizeof(CheckpointHeader)], buffer.size() - sizeof(CheckpointHeader));
+		FILE *out = fopen(temp.c_str(), "wb");
+		bool ok = out != NULL && fwrite(&buffer[0], 1, buffer.size(), out) == buffer.size()
+				&& fflush(out) == 0 && fsync(fileno(out)) == 0;
+		ok = (out != NULL && fclose(out) == 0) && ok;
+		ok = ok && rename(temp.c_str(), filename_.c_str()) == 0;
+		double seconds = now() - start;
+
+		lock.lock();
+		state_[k] = FREE;
+		writeSeconds += seconds;
+		if (ok)
+		{
+			++written;
+		}
+		else
+		{
+			++failures;
+		}
+		idle_.notify_all();
+	}
+}
+
+int Checkpointer::load(const char *filename, Solver *solver)
+{
+	FILE *in = fopen(filename, "rb");
+	if (in == NULL)
+	{
+		return 1;
+	}
+
+	CheckpointHeader header;
+	size_t rows = (size_t) solver->length;
+	size_t features = (size_t) solver->features;
+	std::vector<char> arrays((2 * rows + features) * sizeof(double));
+	bool ok = fread(&header, sizeof(header), 1, in) == 1
+			&& memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) == 0
+			&& header.version == CHECKPOINT_VERSION && header.kernel == (uint32_t) solver->kernelType
+			&& header.rows == rows && header.features == features && header.gamma == solver->gamma
+			&& header.data == fingerprint(*solver)
+			&& fread(arrays.data(), 1, arrays.size(), in) == arrays.size()
+			&& header.checksum == fnv(arrays.data(), arrays.size());
+	fclose(in);
+	if (!ok)
+	{
+		return 1;
+	}
+
+	const char *p = arrays.data();
+	memcpy(solver->alpha, p, rows * sizeof(double));
+	memcpy(solver->error, p + rows * sizeof(double), rows * sizeof(double));
+	memcpy(solver->w, p + 2 * rows * sizeof(double), features * sizeof(double));
+	solver->b = header.b;
+	solver->historyB = header.b;
+	solver->updates = header.updates;
+	solver->loop.passes = header.passes;
+	solver->loop.index = header.index;
+	solver->loop.numChanged = header.numChanged;
+	solver->loop.examineAll = header.examineAll != 0;
+	solver->rng.restore(header.rng);
+	solver->dual = solver->objective();
+	return 0;
+}
+
+}
+;
+// namespace
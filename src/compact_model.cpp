@@ -0,0 +1,86 @@
+#include <mysvm.h>
+#include <compact_model.h>
+
+namespace MySVM
+{
+
+CompactModel::CompactModel(const Model &model, size_t denseLimit) :
+	kernelType(model.kernelType), gamma(model.gamma), b(model.b), count(0), features(0),
+	stride(0), dense(true), w(NULL), coef(NULL), norm(NULL), rows(NULL), sparse(NULL)
+{
+	if (kernelType == KERNEL_LINEAR)
+	{
+		features = model.w.size();
+		arena_.reset(Arena::align(features * sizeof(double)));
+		double *weights = arena_.allocate<double>(features);
+		std::copy(model.w.begin(), model.w.end(), weights);
+		w = weights;
+		return;
+	}
+
+	count = model.sv.size();
+	size_t elements = 0;
+	for (int k = 0; k < count; k++)
+	{
+		for (const Feature *f = &model.sv[k][0]; f->index != -1; ++f)
+		{
+			features = std::max(features, f->index);
+			++elements;
+		}
+	}
+	stride = (features + 7) & ~7;
+	dense = (size_t) count * stride * sizeof(double) <= denseLimit;
+
+	size_t bytes = 2 * Arena::align(count * sizeof(double));
+	if (dense)
+	{
+		bytes += Arena::align((size_t) count * stride * sizeof(double));
+	}
+	else
+	{
+		bytes += Arena::align(count * sizeof(Feature *)) + Arena::align((elements + count) * sizeof(Feature));
+	}
+	arena_.reset(bytes);
+
+	double *c = arena_.allocate<double>(count);
+	double *n = arena_.allocate<double>(count);
+	for (int k = 0; k < count; k++)
+	{
+		c[k] = model.coef[k];
+		n[k] = dot(&model.sv[k][0], &model.sv[k][0]);
+	}
+	coef = c;
+	norm = n;
+
+	if (dense)
+	{
+		// the arena is zeroed, only the stored features are written
+		double *r = arena_.allocate<double>((size_t) count * stride);
+		for (int k = 0; k < count; k++)
+		{
+			for (const Feature *f = &model.sv[k][0]; f->index != -1; ++f)
+			{
+				r[(size_t) k * stride + f->index - 1] = f->value;
+			}
+		}
+		rows = r;
+		return;
+	}
+
+	const Feature **p = arena_.allocate<const Feature *>(count);
+	Feature *next = arena_.allocate<Feature>(elements + count);
+	for (int k = 0; k < count; k++)
+	{
+		p[k] = next;
+		for (const Feature *f = &model.sv[k][0]; f->index != -1; ++f)
+		{
+			*next++ = *f;
+		}
+		(next++)->index = -1;
+	}
+	sparse = p;
+}
+
+}
+;
+// namespace
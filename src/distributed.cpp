@@ -0,0 +1,836 @@
+#include <mysvm.h>
+#include <distributed.h>
+#include <errno.h>
+#include <limits.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+namespace MySVM
+{
+
+/** \brief A candidate alpha for the working pair: (sort key, global index) */
+typedef std::pair<double, int64_t> Candidate;
+
+/** \brief Opens a socket for address; listens on it, or connects to it */
+static int openSocket(const char *address, bool listening)
+{
+	if (strncmp(address, "unix:", 5) == 0)
+	{
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (strlen(address + 5) >= sizeof(addr.sun_path))
+		{
+			return -1;
+		}
+		strcpy(addr.sun_path, address + 5);
+
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0)
+		{
+			return -1;
+		}
+		if (listening)
+		{
+			unlink(addr.sun_path);
+			if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0 && listen(fd, 64) == 0)
+			{
+				return fd;
+			}
+		}
+		else if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0)
+		{
+			return fd;
+		}
+		close(fd);
+		return -1;
+	}
+
+	if (strncmp(address, "tcp:", 4) == 0)
+	{
+		std::string host(address + 4);
+		size_t colon = host.rfind(':');
+		if (colon == std::string::npos)
+		{
+			return -1;
+		}
+		std::string port = host.substr(colon + 1);
+		host = host.substr(0, colon);
+
+		struct addrinfo hints, *res;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = listening ? AI_PASSIVE : 0;
+		if (getaddrinfo(host.empty() ? NULL : host.c_str(), port.c_str(), &hints, &res) != 0)
+		{
+			return -1;
+		}
+
+		int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+		if (fd >= 0)
+		{
+			int one = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+			bool ok;
+			if (listening)
+			{
+				setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+				ok = bind(fd, res->ai_addr, res->ai_addrlen) == 0 && listen(fd, 64) == 0;
+			}
+			else
+			{
+				ok = connect(fd, res->ai_addr, res->ai_addrlen) == 0;
+			}
+			if (!ok)
+			{
+				close(fd);
+				fd = -1;
+			}
+		}
+		freeaddrinfo(res);
+		return fd;
+	}
+
+	return -1;
+}
+
+static bool sendAll(int fd, const void *data, size_t bytes)
+{
+	const char *p = (const char *) data;
+	while (bytes > 0)
+	{
+		ssize_t n = send(fd, p, bytes, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			return false;
+		}
+		p += n;
+		bytes -= n;
+	}
+	return true;
+}
+
+static bool recvAll(int fd, void *data, size_t bytes)
+{
+	char *p = (char *) data;
+	while (bytes > 0)
+	{
+		ssize_t n = recv(fd, p, bytes, 0);
+		if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			return false;
+		}
+		p += n;
+		bytes -= n;
+	}
+	return true;
+}
+
+/** \brief Sends a message whose payload is the concatenation of up to three buffers */
+static bool sendMessage(int fd, MessageType type, const void *a, size_t na,
+		const void *b = NULL, size_t nb = 0, const void *c = NULL, size_t nc = 0)
+{
+	MessageHeader header;
+	header.type = type;
+	header.reserved = 0;
+	header.bytes = na + nb + nc;
+	return sendAll(fd, &header, sizeof(header)) && sendAll(fd, a, na)
+			&& sendAll(fd, b, nb) && sendAll(fd, c, nc);
+}
+
+/**	\brief Receives a message of the expected type and payload size into payload
+ *
+ * 	The header is checked before anything is allocated, so a confused or
+ * 	hostile peer can't make the receiver reserve an arbitrary amount of memory.
+ */
+static bool recvMessage(int fd, MessageType type, std::vector<char> &payload, size_t bytes)
+{
+	MessageHeader header;
+	if (!recvAll(fd, &header, sizeof(header)) || header.type != (uint32_t) type || header.bytes != bytes)
+	{
+		return false;
+	}
+	payload.resize(bytes);
+	return bytes == 0 || recvAll(fd, &payload[0], bytes);
+}
+
+/** \brief Stored features of a sparse row, the terminator excluded */
+static long rowLength(const Feature *row)
+{
+	const Feature *f = row;
+	while (f->index != -1)
+	{
+		++f;
+	}
+	return f - row;
+}
+
+/**	\brief Sends shard, with its labels and sparse rows taken from prob, as a MSG_SHARD
+ *
+ * 	The rows of a subset of a problem (cross validation) are not contiguous,
+ * 	so they are copied out a chunk at a time rather than sent from prob.space.
+ * 	\param shard begin, rows and the kernel filled in; elements is set here
+ */
+static bool sendShard(int fd, const Problem &prob, ShardHeader *shard)
+{
+	shard->elements = 0;
+	for (long i = 0; i < shard->rows; i++)
+	{
+		shard->elements += rowLength(prob.x[shard->begin + i]);
+	}
+
+	MessageHeader header;
+	header.type = MSG_SHARD;
+	header.reserved = 0;
+	header.bytes = sizeof(*shard) + shard->rows * sizeof(double)
+			+ (shard->elements + shard->rows) * sizeof(Feature);
+	bool ok = sendAll(fd, &header, sizeof(header)) && sendAll(fd, shard, sizeof(*shard))
+			&& sendAll(fd, &prob.y[shard->begin], shard->rows * sizeof(double));
+
+	std::vector<Feature> chunk;
+	chunk.reserve(4096);
+	for (long i = 0; ok && i < shard->rows; i++)
+	{
+		const Feature *f = prob.x[shard->begin + i];
+		do
+		{
+			chunk.push_back(*f);
+		} while ((f++)->index != -1);
+		if (chunk.size() >= 4096 || i + 1 == shard->rows)
+		{
+			ok = sendAll(fd, &chunk[0], chunk.size() * sizeof(Feature));
+			chunk.clear();
+		}
+	}
+	return ok;
+}
+
+/**	\brief Receives every worker's MSG_ERRORS into error
+ * 	\param shards what was sent to each peer; the answers must cover the same rows
+ */
+static bool collectErrors(const std::vector<int> &peers, const std::vector<ShardHeader> &shards,
+		double *error, std::vector<char> &payload)
+{
+	bool ok = true;
+	for (size_t k = 0; ok && k < peers.size(); k++)
+	{
+		ShardHeader shard;
+		ok = recvMessage(peers[k], MSG_ERRORS, payload, sizeof(shard) + shards[k].rows * sizeof(double));
+		if (ok)
+		{
+			memcpy(&shard, &payload[0], sizeof(shard));
+			ok = shard.begin == shards[k].begin && shard.rows == shards[k].rows;
+		}
+		if (ok)
+		{
+			memcpy(&error[shard.begin], &payload[sizeof(shard)], shard.rows * sizeof(double));
+		}
+	}
+	return ok;
+}
+
+/**	\brief Accepts count workers on listener
+ * 	\param children local worker processes; waiting stops when one of them exits
+ * 	\return The connected sockets, fewer than count on a failure
+ */
+static std::vector<int> acceptWorkers(int listener, int count, const std::vector<pid_t> &children)
+{
+	std::vector<int> peers;
+	while ((int) peers.size() < count)
+	{
+		// wake up now and then to see whether a forked worker died before connecting
+		struct pollfd ready;
+		ready.fd = listener;
+		ready.events = POLLIN;
+		ready.revents = 0;
+		int n = poll(&ready, 1, 200);
+		if (n < 0 && errno != EINTR)
+		{
+			break;
+		}
+		if (n > 0)
+		{
+			int fd = accept(listener, NULL, NULL);
+			if (fd >= 0)
+			{
+				peers.push_back(fd);
+			}
+			else if (errno != EINTR && errno != ECONNABORTED)
+			{
+				break;
+			}
+			continue;
+		}
+
+		bool exited = false;
+		for (size_t k = 0; k < children.size(); k++)
+		{
+			if (waitpid(children[k], NULL, WNOHANG) == children[k])
+			{
+				fprintf(stderr, "worker process %d exited before all workers connected\n", (int) children[k]);
+				exited = true;
+			}
+		}
+		if (exited)
+		{
+			break;
+		}
+	}
+	return peers;
+}
+
+/**
+ * \brief The two rows of a step: a two row Solver for Solver::step(), whose
+ * rows are densified from the problem as the pairs change
+ */
+struct PairSolver {
+	Solver solver;
+	std::vector<double> space;	//[2][M]
+	double *rows[2];
+	double y[2];
+	int64_t loaded[2];			///< row of the problem in each slot, -1 for none
+
+	explicit PairSolver(const Coordinator &coordinator)
+	{
+		int features = coordinator.problem().features;
+		space.assign(2 * (size_t) features + 1, 0);
+		rows[0] = &space[0];
+		rows[1] = &space[features];
+		loaded[0] = loaded[1] = -1;
+		y[0] = y[1] = 0;
+		solver.length = 2;
+		solver.features = features;
+		solver.kernelType = coordinator.kernelType;
+		solver.gamma = coordinator.gamma;
+		solver.x = rows;
+		solver.y = y;
+		solver.init(0);
+	}
+
+	/** \brief The slot holding row, densified into the one not holding keep if it isn't loaded */
+	int slot(const Problem &prob, int64_t row, int64_t keep)
+	{
+		for (int k = 0; k < 2; k++)
+		{
+			if (loaded[k] == row)
+			{
+				return k;
+			}
+		}
+		int k = (loaded[0] == keep) ? 1 : 0;
+		memset(rows[k], 0, (size_t) prob.features * sizeof(double));
+		for (const Feature *f = prob.x[row]; f->index != -1; ++f)
+		{
+			rows[k][f->index - 1] = f->value;
+		}
+		y[k] = prob.y[row];
+		loaded[k] = row;
+		return k;
+	}
+};
+
+/** \brief Solver::step() for rows i and j of the problem, at the coordinator's alphas and threshold */
+static bool pairStep(const Coordinator &coordinator, PairSolver &pair, int64_t i, int64_t j,
+		double Ei, double Ej, Step *s)
+{
+	if (i == j)
+	{
+		return false;
+	}
+	int si = pair.slot(coordinator.problem(), i, j);
+	int sj = pair.slot(coordinator.problem(), j, i);
+	pair.solver.alpha[si] = coordinator.alpha[i];
+	pair.solver.alpha[sj] = coordinator.alpha[j];
+	pair.solver.b = coordinator.b;
+	// snapping an alpha to a bound can cost a step some dual objective, and two
+	// such steps can undo each other forever; only steps that gain are taken
+	if (!pair.solver.step(si, sj, Ei, Ej, s) || s->gain <= 0)
+	{
+		return false;
+	}
+	s->index_i = i;
+	s->index_j = j;
+	return true;
+}
+
+/** \brief pairStep() for the pair in either order
+ *
+ * 	step() rejects moves of its second alpha below EPS * (new + old + EPS), but
+ * 	not of its first, so an alpha just short of a bound may only move as the first.
+ */
+static bool stepPair(const Coordinator &coordinator, PairSolver &pair, const Candidate &up,
+		const Candidate &low, Step *s)
+{
+	return pairStep(coordinator, pair, up.second, low.second, up.first, -low.first, s)
+			|| pairStep(coordinator, pair, low.second, up.second, -low.first, up.first, s);
+}
+
+/**	\brief Searches all rows for the most violating pair that can still step
+ * 	\param error the errors of all rows, as collected from the workers
+ * 	\param violation set to the largest violation, E_low - E_up, over all pairs
+ * 	\return Whether a pair violating by more than twice the tolerance can step
+ */
+static bool scanPairs(const Coordinator &coordinator, PairSolver &pair, const double *error, Step *s,
+		double *violation)
+{
+	const Problem &prob = coordinator.problem();
+	std::vector<Candidate> up, low;
+	for (int r = 0; r < prob.length; r++)
+	{
+		double a = coordinator.alpha[r];
+		bool positive = prob.y[r] > 0;
+		if ((positive && a < C) || (!positive && a > 0))
+		{
+			up.push_back(Candidate(error[r], r));
+		}
+		if ((positive && a > 0) || (!positive && a < C))
+		{
+			low.push_back(Candidate(-error[r], r));
+		}
+	}
+	std::sort(up.begin(), up.end());
+	std::sort(low.begin(), low.end());
+
+	*violation = (up.empty() || low.empty()) ? 0 : std::max(-low[0].first - up[0].first, 0.0);
+	for (size_t u = 0; u < up.size(); u++)
+	{
+		for (size_t l = 0; l < low.size() && -low[l].first - up[u].first > 2 * coordinator.tolerance; l++)
+		{
+			if (stepPair(coordinator, pair, up[u], low[l], s))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+Coordinator::Coordinator(const Problem &prob) :
+	alpha(prob.length, 0), b(0), kernelType(KERNEL_LINEAR), gamma(0), tolerance(EPS), updates(0),
+	scans(0), stopReason("converged"), prob_(prob)
+{
+	memset(&result, 0, sizeof(result));
+}
+
+long Coordinator::train(const char *address, int workers)
+{
+	int listener = openSocket(address, true);
+	if (listener < 0)
+	{
+		fprintf(stderr, "can't listen on %s\n", address);
+		return -1;
+	}
+
+	std::vector<int> peers = acceptWorkers(listener, workers, children);
+	close(listener);
+	if (strncmp(address, "unix:", 5) == 0)
+	{
+		unlink(address + 5);
+	}
+
+	const Problem &prob = prob_;
+	long rounds = 0;
+	double dual = 0;
+	std::vector<char> payload;
+	std::vector<ShardHeader> shards(workers);
+	PairSolver pair(*this);
+	bool ok = (int) peers.size() == workers;
+	updates = 0;
+	scans = 0;
+
+	// send every worker its shard of rows
+	for (int k = 0; ok && k < workers; k++)
+	{
+		ShardHeader &shard = shards[k];
+		shard.begin = (long) k * (long) prob.length / workers;
+		shard.rows = (long) (k + 1) * (long) prob.length / workers - shard.begin;
+		shard.features = prob.features;
+		shard.kernel = kernelType;
+		shard.gamma = gamma;
+		ok = sendShard(peers[k], prob, &shard);
+	}
+
+	std::vector<Candidate> up, low;
+	double violation = 0;
+	stopReason = "converged";
+	while (ok)
+	{
+		++rounds;
+		// candidates for the maximal violating pair over all shards
+		up.clear();
+		low.clear();
+		for (int k = 0; ok && k < workers; k++)
+		{
+			ok = recvMessage(peers[k], MSG_REPORT, payload, sizeof(Report));
+			if (!ok)
+			{
+				break;
+			}
+			Report report;
+			memcpy(&report, &payload[0], sizeof(report));
+			for (int c = 0; ok && c < REPORT_CANDIDATES; c++)
+			{
+				ok = report.index_up[c] < prob.length && report.index_low[c] < prob.length;
+				if (ok && report.index_up[c] >= 0)
+				{
+					up.push_back(Candidate(report.error_up[c], report.index_up[c]));
+				}
+				if (ok && report.index_low[c] >= 0)
+				{
+					low.push_back(Candidate(-report.error_low[c], report.index_low[c]));
+				}
+			}
+		}
+		if (!ok)
+		{
+			break;
+		}
+		std::sort(up.begin(), up.end());
+		std::sort(low.begin(), low.end());
+
+		// most violating pair first; the first candidates on each side are the
+		// global extremes, so training has converged when they violate by no
+		// more than twice the tolerance
+		Step s;
+		bool found = false;
+		violation = (up.empty() || low.empty()) ? 0 : std::max(-low[0].first - up[0].first, 0.0);
+		if (violation <= 2 * tolerance)
+		{
+			break;
+		}
+		for (size_t u = 0; !found && u < up.size() && u < REPORT_CANDIDATES; u++)
+		{
+			for (size_t l = 0; !found && l < low.size() && l < REPORT_CANDIDATES; l++)
+			{
+				double gap = -low[l].first - up[u].first;
+				if (gap > 2 * tolerance)
+				{
+					found = stepPair(*this, pair, up[u], low[l], &s);
+				}
+			}
+		}
+		if (!found)
+		{
+			// none of the reported pairs can step: widen the search to every row,
+			// with the errors held only for the length of the search
+			for (int k = 0; ok && k < workers; k++)
+			{
+				ok = sendMessage(peers[k], MSG_SCAN, NULL, 0);
+			}
+			std::vector<double> error(prob.length);
+			ok = ok && collectErrors(peers, shards, error.data(), payload);
+			if (!ok)
+			{
+				break;
+			}
+			++scans;
+			found = scanPairs(*this, pair, error.data(), &s, &violation);
+		}
+		if (!found)
+		{
+			// pairs still violate, but none of them can move
+			stopReason = "stalled";
+			break;
+		}
+
+		Update update;
+		update.index_i = s.index_i;
+		update.index_j = s.index_j;
+		update.alpha_i = s.alpha_i;
+		update.alpha_j = s.alpha_j;
+		update.delta_i = s.delta_i;
+		update.delta_j = s.delta_j;
+		update.db = s.b - b;
+		alpha[s.index_i] = s.alpha_i;
+		alpha[s.index_j] = s.alpha_j;
+		b = s.b;
+		dual += s.gain;
+		++updates;
+
+		// the pair's rows are still loaded from the step
+		const double *row_i = pair.rows[pair.slot(prob, s.index_i, s.index_j)];
+		const double *row_j = pair.rows[pair.slot(prob, s.index_j, s.index_i)];
+		for (int k = 0; ok && k < workers; k++)
+		{
+			ok = sendMessage(peers[k], MSG_UPDATE, &update, sizeof(update),
+					row_i, prob.features * sizeof(double), row_j, prob.features * sizeof(double));
+		}
+	}
+
+	// the final errors measure the result
+	for (int k = 0; ok && k < workers; k++)
+	{
+		ok = sendMessage(peers[k], MSG_FINISH, NULL, 0);
+	}
+	if (ok)
+	{
+		std::vector<double> error(prob.length);
+		ok = collectErrors(peers, shards, error.data(), payload);
+		if (ok)
+		{
+			measure_errors(prob.length, prob.y, alpha.data(), error.data(), b, dual, &result);
+			result.passes = rounds;
+			result.updates = updates;
+		}
+	}
+
+	for (size_t k = 0; k < peers.size(); k++)
+	{
+		close(peers[k]);
+	}
+	if (ok && strcmp(stopReason, "converged") != 0)
+	{
+		fprintf(stderr, "distributed training stalled after %ld rounds: KKT violation %g is above "
+				"twice the tolerance, %g, but no violating pair can move\n", rounds, violation, 2 * tolerance);
+	}
+	return ok ? rounds : -1;
+}
+
+/** \brief Inserts (key, index) into a list of the smallest keys kept in ascending order */
+static void keepSmallest(int64_t *indices, double *keys, double key, int64_t index)
+{
+	int c = REPORT_CANDIDATES;
+	while (c > 0 && (indices[c - 1] < 0 || key < keys[c - 1]))
+	{
+		--c;
+	}
+	if (c == REPORT_CANDIDATES)
+	{
+		return;
+	}
+	for (int k = REPORT_CANDIDATES - 1; k > c; k--)
+	{
+		indices[k] = indices[k - 1];
+		keys[k] = keys[k - 1];
+	}
+	indices[c] = index;
+	keys[c] = key;
+}
+
+/** \brief Fills report with the extreme errors of the worker's shard */
+static void shardReport(const Solver &shard, long begin, Report *report)
+{
+	for (int c = 0; c < REPORT_CANDIDATES; c++)
+	{
+		report->index_up[c] = report->index_low[c] = -1;
+		report->error_up[c] = report->error_low[c] = 0;
+	}
+	for (int r = 0; r < shard.length; r++)
+	{
+		double a = shard.alpha[r];
+		bool positive = shard.y[r] > 0;
+		if ((positive && a < C) || (!positive && a > 0))
+		{
+			keepSmallest(report->index_up, report->error_up, shard.error[r], begin + r);
+		}
+		if ((positive && a > 0) || (!positive && a < C))
+		{
+			// largest errors first: keep the smallest negated errors
+			keepSmallest(report->index_low, report->error_low, -shard.error[r], begin + r);
+		}
+	}
+	for (int c = 0; c < REPORT_CANDIDATES; c++)
+	{
+		report->error_low[c] = -report->error_low[c];
+	}
+}
+
+/**	\brief Receives the MSG_SHARD, checking its sizes before allocating anything for it
+ * 	\param y set to the labels of the shard's rows
+ * 	\param space set to the shard's rows densified, followed by two zero rows
+ * 	\return Whether the shard was well formed, and fit in memory
+ */
+static bool recvShard(int fd, ShardHeader *shard, std::vector<double> *y, std::vector<double> *space)
+{
+	MessageHeader header;
+	if (!recvAll(fd, &header, sizeof(header)) || header.type != MSG_SHARD || header.bytes < sizeof(*shard)
+			|| !recvAll(fd, shard, sizeof(*shard)))
+	{
+		return false;
+	}
+	int64_t rows = shard->rows, features = shard->features, elements = shard->elements;
+	// bounded so that none of the sizes below overflows
+	if (rows < 0 || rows > INT_MAX - 2 || features < 0 || features > INT_MAX || elements < 0
+			|| elements > rows * features || elements > ((int64_t) 1 << 56) || (shard->kernel != KERNEL_LINEAR && shard->kernel != KERNEL_RBF)
+			|| header.bytes != sizeof(*shard) + rows * sizeof(double) + (elements + rows) * sizeof(Feature))
+	{
+		return false;
+	}
+
+	std::vector<Feature> sparse;
+	try
+	{
+		y->resize(rows);
+		sparse.resize(elements + rows);
+		space->assign((size_t) (rows + 2) * features + 1, 0);
+	}
+	catch (const std::bad_alloc &e)
+	{
+		return false;
+	}
+	if ((rows > 0 && !recvAll(fd, &(*y)[0], rows * sizeof(double)))
+			|| !recvAll(fd, &sparse[0], sparse.size() * sizeof(Feature)))
+	{
+		return false;
+	}
+
+	// every row ends with index -1, and its indices increase within [1, features]
+	const Feature *f = sparse.data();
+	for (int64_t r = 0; r < rows; r++)
+	{
+		int last = 0;
+		for (; f->index != -1; ++f)
+		{
+			if (f == &sparse.back() || f->index <= last || f->index > features)
+			{
+				return false;
+			}
+			last = f->index;
+			(*space)[r * features + f->index - 1] = f->value;
+		}
+		++f;
+	}
+	return f == sparse.data() + sparse.size();
+}
+
+int runWorker(const char *address)
+{
+	int fd = -1;
+	// the coordinator may not be listening yet
+	for (int attempt = 0; attempt < 100 && fd < 0; attempt++)
+	{
+		fd = openSocket(address, false);
+		if (fd < 0)
+		{
+			usleep(100000);
+		}
+	}
+	if (fd < 0)
+	{
+		fprintf(stderr, "can't connect to %s\n", address);
+		return 1;
+	}
+
+	// the shard is a Solver over the local rows, plus two scratch rows for the
+	// pair being updated, so that the errors use the solver's own kernel
+	ShardHeader shard;
+	std::vector<double> y, space;
+	if (!recvShard(fd, &shard, &y, &space))
+	{
+		fprintf(stderr, "malformed shard from %s\n", address);
+		close(fd);
+		return 1;
+	}
+	int features = shard.features;
+	std::vector<double *> x(shard.rows + 2);
+	for (long r = 0; r < shard.rows + 2; r++)
+	{
+		x[r] = &space[r * features];
+	}
+
+	Solver solver;
+	solver.length = shard.rows;
+	solver.features = features;
+	solver.kernelType = (KernelType) shard.kernel;
+	solver.gamma = shard.gamma;
+	solver.x = x.data();
+	solver.y = y.data();
+	solver.init(0);
+
+	int scratch_i = shard.rows;
+	int scratch_j = shard.rows + 1;
+	bool ok = true;
+	bool reporting = true;
+	Update update;
+	std::vector<char> payload(sizeof(update) + 2 * features * sizeof(double));
+	for (;;)
+	{
+		// after a scan the errors have not changed, so the last report stands
+		if (reporting)
+		{
+			Report report;
+			shardReport(solver, shard.begin, &report);
+			if (!sendMessage(fd, MSG_REPORT, &report, sizeof(report)))
+			{
+				ok = false;
+				break;
+			}
+		}
+		reporting = true;
+
+		MessageHeader header;
+		if (!recvAll(fd, &header, sizeof(header)))
+		{
+			ok = false;
+			break;
+		}
+		if (header.type == MSG_FINISH && header.bytes == 0)
+		{
+			break;
+		}
+		if (header.type == MSG_SCAN)
+		{
+			if (header.bytes != 0 || !sendMessage(fd, MSG_ERRORS, &shard, sizeof(shard),
+					solver.error, shard.rows * sizeof(double)))
+			{
+				ok = false;
+				break;
+			}
+			reporting = false;
+			continue;
+		}
+
+		// the size is checked before reading, into a payload sized for updates
+		if (header.type != MSG_UPDATE || header.bytes != payload.size()
+				|| !recvAll(fd, &payload[0], payload.size()))
+		{
+			ok = false;
+			break;
+		}
+		memcpy(&update, &payload[0], sizeof(update));
+		memcpy(x[scratch_i], &payload[sizeof(update)], features * sizeof(double));
+		memcpy(x[scratch_j], &payload[sizeof(update) + features * sizeof(double)],
+				features * sizeof(double));
+
+		for (int r = 0; r < solver.length; r++)
+		{
+			solver.error[r] += update.delta_i * solver.kernel(solver.x, r, scratch_i)
+					+ update.delta_j * solver.kernel(solver.x, r, scratch_j) - update.db;
+		}
+		if (update.index_i >= shard.begin && update.index_i < shard.begin + shard.rows)
+		{
+			solver.alpha[update.index_i - shard.begin] = update.alpha_i;
+		}
+		if (update.index_j >= shard.begin && update.index_j < shard.begin + shard.rows)
+		{
+			solver.alpha[update.index_j - shard.begin] = update.alpha_j;
+		}
+	}
+
+	if (ok)
+	{
+		ok = sendMessage(fd, MSG_ERRORS, &shard, sizeof(shard),
+				solver.error, shard.rows * sizeof(double));
+	}
+	close(fd);
+	return ok ? 0 : 1;
+}
+
+}
+;
+// namespace
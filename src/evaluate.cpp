@@ -0,0 +1,290 @@
+#include <mysvm.h>
+#include <evaluate.h>
+#include <thread_pool.h>
+#include <time.h>
+
+// inner loops built for AVX2 as well, chosen at load time by the CPU
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define SIMD_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define SIMD_CLONES
+#endif
+
+namespace MySVM
+{
+
+#define BLOCK 32			// rows scored together
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** \brief out[r] = <rows[r], w> - b; w covers every index that occurs */
+SIMD_CLONES
+static void linearBlock(const Feature *const *rows, int count, const double *w, double b, double *out)
+{
+	for (int r = 0; r < count; r++)
+	{
+		// two independent partial sums, so that the multiply-adds overlap; a
+		// row ends with its terminator, so x[1] can be read whenever x[0] is a feature
+		const Feature *x = rows[r];
+		double s0 = 0, s1 = 0;
+		for (; x[0].index != -1 && x[1].index != -1; x += 2)
+		{
+			s0 += w[x[0].index - 1] * x[0].value;
+			s1 += w[x[1].index - 1] * x[1].value;
+		}
+		if (x->index != -1)
+		{
+			s0 += w[x->index - 1] * x->value;
+		}
+		out[r] = (s0 + s1) - b;
+	}
+}
+
+/** \brief Dense dot product of length n */
+SIMD_CLONES
+static double denseDot(const double *a, const double *b, int n)
+{
+	double s[4] = { 0, 0, 0, 0 };
+	int k = 0;
+	for (; k + 4 <= n; k += 4)
+	{
+		s[0] += a[k] * b[k];
+		s[1] += a[k + 1] * b[k + 1];
+		s[2] += a[k + 2] * b[k + 2];
+		s[3] += a[k + 3] * b[k + 3];
+	}
+	for (; k < n; k++)
+	{
+		s[0] += a[k] * b[k];
+	}
+	return (s[0] + s[1]) + (s[2] + s[3]);
+}
+
+/** \brief out[r] = sum_k coef_k exp(-gamma |rows[r] - sv_k|^2) - b, a block of rows against all dense support vectors */
+static void rbfBlock(const CompactModel &model, const Feature *const *rows, int count,
+		std::vector<double> &scratch, double *out)
+{
+	int features = model.features;
+	int stride = model.stride;
+	double norm[BLOCK];
+	for (int r = 0; r < count; r++)
+	{
+		double *dense = scratch.data() + (size_t) r * stride;
+		norm[r] = 0;
+		for (const Feature *x = rows[r]; x->index != -1; ++x)
+		{
+			// indices past the support vectors meet zeros there: they only add to |x|^2
+			if (x->index <= features)
+			{
+				dense[x->index - 1] = x->value;
+			}
+			norm[r] += x->value * x->value;
+		}
+		out[r] = -model.b;
+	}
+
+	for (int k = 0; k < model.count; k++)
+	{
+		const double *v = model.rows + (size_t) k * stride;
+		for (int r = 0; r < count; r++)
+		{
+			double d = norm[r] + model.norm[k] - 2 * denseDot(scratch.data() + (size_t) r * stride, v, stride);
+			out[r] += model.coef[k] * exp(-model.gamma * std::max(d, 0.0));
+		}
+	}
+
+	// leave the scratch rows zero for the next block
+	for (int r = 0; r < count; r++)
+	{
+		double *dense = scratch.data() + (size_t) r * stride;
+		for (const Feature *x = rows[r]; x->index != -1 && x->index <= features; ++x)
+		{
+			dense[x->index - 1] = 0;
+		}
+	}
+}
+
+double decision_value(const CompactModel &model, const Feature *x, std::vector<double> *scratch)
+{
+	double f = -model.b;
+	if (model.kernelType == KERNEL_LINEAR)
+	{
+		for (; x->index != -1 && x->index <= model.features; ++x)
+		{
+			f += model.w[x->index - 1] * x->value;
+		}
+		return f;
+	}
+	if (model.dense)
+	{
+		if (scratch->size() < (size_t) model.stride)
+		{
+			scratch->assign(model.stride, 0);
+		}
+		rbfBlock(model, &x, 1, *scratch, &f);
+		return f;
+	}
+	for (int k = 0; k < model.count; k++)
+	{
+		f += model.coef[k] * exp(-model.gamma * distance(model.sparse[k], x));
+	}
+	return f;
+}
+
+/** \brief Mann-Whitney estimate of the AUC, average ranks for tied scores;
+ * NaN scores rank above everything else and tie with each other */
+static double auc(const std::vector<double> &values, const double *y, int length)
+{
+	std::vector<int> order(length);
+	for (int i = 0; i < length; i++)
+	{
+		order[i] = i;
+	}
+	// a total order: NaN compares false both ways, which std::sort must not see
+	std::sort(order.begin(), order.end(), [&](int a, int b)
+	{
+		return std::isnan(values[b]) ? !std::isnan(values[a]) : values[a] < values[b];
+	});
+
+	double rankSum = 0;
+	long positives = 0;
+	for (int s = 0; s < length;)
+	{
+		double first = values[order[s]];
+		int e = s + 1;
+		while (e < length && (values[order[e]] == first || (std::isnan(first) && std::isnan(values[order[e]]))))
+		{
+			++e;
+		}
+		double rank = (s + 1 + e) / 2.0;	// average of the ranks s + 1 .. e
+		for (int k = s; k < e; k++)
+		{
+			if (y[order[k]] > 0)
+			{
+				rankSum += rank;
+				++positives;
+			}
+		}
+		s = e;
+	}
+	long negatives = length - positives;
+	if (positives == 0 || negatives == 0)
+	{
+		return 0;
+	}
+	return (rankSum - positives * (positives + 1) / 2.0) / ((double) positives * negatives);
+}
+
+Evaluation evaluate(const Model &model, const Problem &prob, int threads, std::vector<double> *values)
+{
+	CompactModel compact(model);
+	if (model.map.type == MAP_NONE)
+	{
+		return evaluate(compact, prob, threads, values);
+	}
+
+	// the rows are mapped up front; the time spent counts towards the scoring pass
+	double start = now();
+	Problem mapped;
+	model.map.apply(prob, &mapped, threads);
+	double seconds = now() - start;
+	Evaluation result = evaluate(compact, mapped, threads, values);
+	result.seconds += seconds;
+	return result;
+}
+
+Evaluation evaluate(const CompactModel &model, const Problem &prob, int threads, std::vector<double> *values)
+{
+	double start = now();
+	std::vector<double> scores(prob.length);
+	ThreadPool pool(std::max(threads, 1));
+	std::vector<Evaluation> counts(pool.size());
+
+	// w padded to every index of prob, so that the inner loop needs no bounds test
+	std::vector<double> w;
+	if (model.kernelType == KERNEL_LINEAR)
+	{
+		w.assign(std::max(prob.features, model.features) + 1, 0);
+		std::copy(model.w, model.w + model.features, w.begin());
+	}
+	bool dense = model.kernelType != KERNEL_LINEAR && model.dense;
+
+	pool.run([&](int thread, int nthreads)
+	{
+		long begin, end;
+		ThreadPool::range(prob.length, thread, nthreads, &begin, &end);
+		std::vector<double> scratch(dense ? (size_t) BLOCK * model.stride : 0, 0);
+		Evaluation &c = counts[thread];
+
+		for (long i = begin; i < end; i += BLOCK)
+		{
+			int count = (int) std::min((long) BLOCK, end - i);
+			double *out = &scores[i];
+			if (model.kernelType == KERNEL_LINEAR)
+			{
+				linearBlock(prob.x + i, count, &w[0], model.b, out);
+			}
+			else if (dense)
+			{
+				rbfBlock(model, prob.x + i, count, scratch, out);
+			}
+			else
+			{
+				for (int r = 0; r < count; r++)
+				{
+					out[r] = -model.b;
+					for (int k = 0; k < model.count; k++)
+					{
+						out[r] += model.coef[k] * exp(-model.gamma * distance(model.sparse[k], prob.x[i + r]));
+					}
+				}
+			}
+
+			for (int r = 0; r < count; r++)
+			{
+				bool positive = prob.y[i + r] > 0;
+				bool predicted = out[r] > 0;
+				c.truePositives += positive && predicted;
+				c.falseNegatives += positive && !predicted;
+				c.falsePositives += !positive && predicted;
+				c.trueNegatives += !positive && !predicted;
+			}
+		}
+	});
+
+	Evaluation result;
+	result.rows = prob.length;
+	for (size_t t = 0; t < counts.size(); t++)
+	{
+		result.truePositives += counts[t].truePositives;
+		result.falsePositives += counts[t].falsePositives;
+		result.trueNegatives += counts[t].trueNegatives;
+		result.falseNegatives += counts[t].falseNegatives;
+	}
+	result.seconds = now() - start;
+	result.auc = auc(scores, prob.y, prob.length);
+
+	if (values != NULL)
+	{
+		values->swap(scores);
+	}
+	return result;
+}
+
+void Evaluation::print(const char *what) const
+{
+	printf("%s: accuracy %.2f%% (%ld/%ld), AUC %.4f, %.3f s, %.0f rows/s\n", what,
+			100 * accuracy(), truePositives + trueNegatives, rows, auc, seconds,
+			rows / std::max(seconds, 1e-9));
+	printf("%s: confusion (rows true, columns predicted)   +1: %ld %ld   -1: %ld %ld\n", what,
+			truePositives, falseNegatives, falsePositives, trueNegatives);
+}
+
+}
+;
+// namespace
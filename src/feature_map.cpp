@@ -0,0 +1,189 @@
+#include <mysvm.h>
+#include <feature_map.h>
+#include <random.h>
+#include <thread_pool.h>
+
+namespace MySVM
+{
+
+#define NYSTROEM_JITTER 1e-6	// added to the diagonal of the landmark kernel matrix
+
+void FeatureMap::fitRff(int features, double gamma, int dim, uint64_t seed)
+{
+	type = MAP_RFF;
+	this->features = features;
+	this->gamma = gamma;
+	this->dim = dim;
+	this->seed = seed;
+	landmarks.clear();
+	factor.clear();
+	prepare();
+}
+
+void FeatureMap::fitNystroem(const Problem &prob, double gamma, int dim, uint64_t seed)
+{
+	type = MAP_NYSTROEM;
+	features = prob.features;
+	this->gamma = gamma;
+	this->dim = std::min(dim, prob.length);
+	this->seed = seed;
+
+	// landmarks: the first rows of a seeded shuffle
+	std::vector<int> order(prob.length);
+	for (int i = 0; i < prob.length; i++)
+	{
+		order[i] = i;
+	}
+	Random rng(seed);
+	if (prob.length > 0)
+	{
+		rng.shuffle(&order[0], prob.length);
+	}
+	landmarks.resize(this->dim);
+	for (int j = 0; j < this->dim; j++)
+	{
+		const Feature *end = prob.x[order[j]];
+		while ((end++)->index != -1)
+		{
+		}
+		landmarks[j].assign((const Feature *) prob.x[order[j]], end);
+	}
+	prepare();
+
+	// Cholesky factor of the landmark kernel matrix, L L' = K + eps I
+	int D = this->dim;
+	factor.assign((size_t) D * D, 0);
+	for (int i = 0; i < D; i++)
+	{
+		for (int j = 0; j <= i; j++)
+		{
+			double k = exp(-gamma * std::max(norm_[i] + norm_[j]
+					- 2 * dot(&landmarks[i][0], &landmarks[j][0]), 0.0));
+			double sum = (i == j) ? k + NYSTROEM_JITTER : k;
+			for (int p = 0; p < j; p++)
+			{
+				sum -= factor[(size_t) i * D + p] * factor[(size_t) j * D + p];
+			}
+			factor[(size_t) i * D + j] = (i == j) ? sqrt(std::max(sum, NYSTROEM_JITTER))
+					: sum / factor[(size_t) j * D + j];
+		}
+	}
+}
+
+void FeatureMap::prepare()
+{
+	omega_.clear();
+	phase_.clear();
+	norm_.clear();
+
+	if (type == MAP_RFF)
+	{
+		// omega ~ N(0, 2 gamma) by Box-Muller, drawn feature by feature
+		omega_.resize((size_t) features * dim);
+		phase_.resize(dim);
+		Random rng(seed);
+		double sigma = sqrt(2 * gamma);
+		for (size_t k = 0; k < omega_.size(); k += 2)
+		{
+			double u = 1 - rng.uniform();
+			double v = rng.uniform();
+			double r = sigma * sqrt(-2 * log(u));
+			omega_[k] = r * cos(2 * M_PI * v);
+			if (k + 1 < omega_.size())
+			{
+				omega_[k + 1] = r * sin(2 * M_PI * v);
+			}
+		}
+		for (int j = 0; j < dim; j++)
+		{
+			phase_[j] = 2 * M_PI * rng.uniform();
+		}
+	}
+	else if (type == MAP_NYSTROEM)
+	{
+		norm_.resize(landmarks.size());
+		for (size_t j = 0; j < landmarks.size(); j++)
+		{
+			norm_[j] = dot(&landmarks[j][0], &landmarks[j][0]);
+		}
+	}
+}
+
+void FeatureMap::apply(const Feature *x, double *z) const
+{
+	if (type == MAP_RFF)
+	{
+		// z = omega x + phase, accumulated one stored feature (one row of omega) at a time
+		std::copy(phase_.begin(), phase_.end(), z);
+		for (; x->index != -1 && x->index <= features; ++x)
+		{
+			const double *o = &omega_[(size_t) (x->index - 1) * dim];
+			double v = x->value;
+			for (int j = 0; j < dim; j++)
+			{
+				z[j] += v * o[j];
+			}
+		}
+		double scale = sqrt(2.0 / dim);
+		for (int j = 0; j < dim; j++)
+		{
+			z[j] = scale * cos(z[j]);
+		}
+		return;
+	}
+
+	// forward substitution L z = k(x)
+	double norm = dot(x, x);
+	for (int i = 0; i < dim; i++)
+	{
+		double sum = exp(-gamma * std::max(norm + norm_[i] - 2 * dot(&landmarks[i][0], x), 0.0));
+		const double *row = &factor[(size_t) i * dim];
+		for (int p = 0; p < i; p++)
+		{
+			sum -= row[p] * z[p];
+		}
+		z[i] = sum / row[i];
+	}
+}
+
+void FeatureMap::apply(const Problem &in, Problem *out, int threads) const
+{
+	free(out->y);
+	free(out->x);
+	free(out->space);
+	out->length = in.length;
+	out->features = dim;
+	out->elements = (long) in.length * dim;
+	out->y = (double *) malloc(in.length * sizeof(double));
+	out->x = (Feature **) malloc(in.length * sizeof(Feature *));
+	out->space = (Feature *) malloc((size_t) in.length * (dim + 1) * sizeof(Feature));
+	if (in.length > 0 && (out->y == NULL || out->x == NULL || out->space == NULL))
+	{
+		throw std::bad_alloc();
+	}
+
+	ThreadPool pool(std::max(threads, 1));
+	pool.run([&](int thread, int nthreads)
+	{
+		long begin, end;
+		ThreadPool::range(in.length, thread, nthreads, &begin, &end);
+		std::vector<double> z(dim);
+		for (long i = begin; i < end; i++)
+		{
+			apply(in.x[i], z.data());
+			Feature *row = out->space + (size_t) i * (dim + 1);
+			for (int j = 0; j < dim; j++)
+			{
+				row[j].index = j + 1;
+				row[j].value = z[j];
+			}
+			row[dim].index = -1;
+			out->x[i] = row;
+			out->y[i] = in.y[i];
+		}
+	});
+}
+
+}
+;
+// namespace
@@ -0,0 +1,148 @@
+#include <mysvm.h>
+#include <huge_pages.h>
+#include <stdint.h>
+#include <new>
+#include <sys/mman.h>
+
+namespace MySVM
+{
+
+/** \brief Default huge page size from /proc/meminfo, 2 MB if it doesn't say */
+static size_t huge_page_size()
+{
+	static size_t size = 0;
+	if (size == 0)
+	{
+		size = 2UL << 20;
+		FILE *in = fopen("/proc/meminfo", "r");
+		char line[256];
+		unsigned long kb;
+		while (in != NULL && fgets(line, sizeof(line), in) != NULL)
+		{
+			if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1 && kb > 0)
+			{
+				size = kb << 10;
+				break;
+			}
+		}
+		if (in != NULL)
+		{
+			fclose(in);
+		}
+	}
+	return size;
+}
+
+const char *page_mode_name(PageMode mode)
+{
+	return (mode == PAGES_HUGETLB) ? "hugetlb" : (mode == PAGES_TRANSPARENT) ? "thp" : "malloc";
+}
+
+PageUsage page_usage(const void *data, size_t bytes)
+{
+	PageUsage usage;
+	usage.bytes = bytes;
+	FILE *in = (data != NULL && bytes > 0) ? fopen("/proc/self/smaps", "r") : NULL;
+	if (in == NULL)
+	{
+		return usage;
+	}
+
+	uintptr_t first = (uintptr_t) data, last = first + bytes;
+	double overlap = 0;		// share of the current mapping inside the block
+	double huge = 0;
+	char line[512];
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		unsigned long start, end, kb;
+		char key[64];
+		if (sscanf(line, "%lx-%lx ", &start, &end) == 2)
+		{
+			uintptr_t from = std::max((uintptr_t) start, first), to = std::min((uintptr_t) end, last);
+			overlap = (to > from) ? (double) (to - from) / (end - start) : 0;
+		}
+		else if (overlap > 0 && sscanf(line, "%63[^:]: %lu kB", key, &kb) == 2
+				&& (strcmp(key, "AnonHugePages") == 0 || strcmp(key, "Private_Hugetlb") == 0
+						|| strcmp(key, "Shared_Hugetlb") == 0))
+		{
+			huge += overlap * kb * 1024.0;
+		}
+	}
+	fclose(in);
+	usage.huge = std::min((size_t) huge, bytes);
+	return usage;
+}
+
+void *PageBlock::allocate(size_t bytes, PageMode mode)
+{
+	release();
+	if (bytes == 0)
+	{
+		return NULL;
+	}
+
+	size_t page = huge_page_size();
+	size_t length = (bytes + page - 1) / page * page;
+	if (mode == PAGES_HUGETLB && bytes >= page)
+	{
+		void *p = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED)
+		{
+			data_ = p;
+			mapped_ = length;
+			mode_ = PAGES_HUGETLB;
+		}
+	}
+	if (data_ == NULL && mode != PAGES_MALLOC && bytes >= page)
+	{
+		// map one huge page more and trim, so that the block starts on a huge page boundary
+		char *p = (char *) mmap(NULL, length + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p != MAP_FAILED)
+		{
+			char *aligned = (char *) (((uintptr_t) p + page - 1) & ~(uintptr_t) (page - 1));
+			if (aligned > p)
+			{
+				munmap(p, aligned - p);
+			}
+			if (aligned + length < p + length + page)
+			{
+				munmap(aligned + length, p + page - aligned);
+			}
+			data_ = aligned;
+			mapped_ = length;
+			// without THP the advice fails and the block keeps plain pages
+			mode_ = (madvise(aligned, length, MADV_HUGEPAGE) == 0) ? PAGES_TRANSPARENT : PAGES_MALLOC;
+		}
+	}
+	if (data_ == NULL)
+	{
+		data_ = aligned_alloc(64, (bytes + 63) & ~(size_t) 63);
+		if (data_ == NULL)
+		{
+			throw std::bad_alloc();
+		}
+		mode_ = PAGES_MALLOC;
+	}
+	bytes_ = bytes;
+	return data_;
+}
+
+void PageBlock::release()
+{
+	if (data_ != NULL && mapped_ > 0)
+	{
+		munmap(data_, mapped_);
+	}
+	else
+	{
+		free(data_);
+	}
+	data_ = NULL;
+	bytes_ = 0;
+	mapped_ = 0;
+	mode_ = PAGES_MALLOC;
+}
+
+}
+;
+// namespace
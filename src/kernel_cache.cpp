@@ -0,0 +1,102 @@
+#include <mysvm.h>
+#include <kernel_cache.h>
+
+namespace MySVM
+{
+
+KernelCache::KernelCache(int length, unsigned long bytes, PageMode pages) :
+	hits(0), misses(0), evictions(0),
+	budget_(bytes), used_(0), peak_(0), lru_(length), length_(length)
+{
+	// update() holds the columns of both alphas of a pair at the same time
+	unsigned long full = charge();
+	if (budget_ < 2 * full)
+	{
+		budget_ = 2 * full;
+	}
+	if (length > 0)
+	{
+		// as many full slots as the budget pays for, and a budget of exactly those
+		size_t slots = std::min((size_t) (budget_ / full), (size_t) length);
+		budget_ = slots * full;
+		double *slab = static_cast<double *>(slab_.allocate(slots * length * sizeof(double), pages));
+		for (size_t k = slots; k-- > 0;)
+		{
+			freeSlots_.push_back(slab + k * length);
+		}
+	}
+}
+
+KernelCache::~KernelCache()
+{
+	KernelColumn *col;
+	int key;
+	while ((col = lru_.oldest(&key)) != NULL)
+	{
+		release(col->data);
+		lru_.remove(key);
+	}
+}
+
+unsigned long KernelCache::charge() const
+{
+	return sizeof(KernelColumn) + length_ * sizeof(double);
+}
+
+void KernelCache::release(double *data)
+{
+	freeSlots_.push_back(data);
+}
+
+double *KernelCache::column(int index, bool *cached)
+{
+	KernelColumn *col = lru_.get(index);
+	*cached = col != NULL;
+	if (col != NULL)
+	{
+		++hits;
+		return col->data;
+	}
+
+	++misses;
+	KernelColumn fresh;
+	fresh.data = NULL;
+	reserve(charge(), index);
+	if (freeSlots_.empty())
+	{
+		throw std::runtime_error("kernel cache allocation failure");
+	}
+	fresh.data = freeSlots_.back();
+	freeSlots_.pop_back();
+	col = lru_.put(index, fresh);
+	used_ += charge();
+
+	if (used_ > peak_)
+	{
+		peak_ = used_;
+	}
+	return col->data;
+}
+
+void KernelCache::reserve(unsigned long bytes, int keep)
+{
+	// The budget covers two full columns, so with at most one other column
+	// in use by the caller the loop never has to evict it.
+	while (used_ + bytes > budget_)
+	{
+		int key;
+		KernelColumn *victim = lru_.oldest(&key);
+		if (victim == NULL || key == keep)
+		{
+			break;
+		}
+		used_ -= charge();
+		release(victim->data);
+		lru_.remove(key);
+		++evictions;
+	}
+}
+
+}
+;
+// namespace
@@ -0,0 +1,158 @@
+#include <mysvm.h>
+#include <linear_solver.h>
+#include <float.h>
+
+namespace MySVM
+{
+
+LinearSolver::LinearSolver(const Problem &prob) :
+	alpha(prob.length, 0), w(prob.features, 0), b(0), seed(1), stopReason("converged"), prob_(prob)
+{
+}
+
+int LinearSolver::train(double cost, double eps, int maxPasses)
+{
+	int length = prob_.length;
+	std::vector<double> QD(length);	// diagonal of the dual Hessian, <x_i, x_i> + 1
+	std::vector<int> index(length);
+	double bias = -b;				// weight of the constant feature
+
+	for (int i = 0; i < length; i++)
+	{
+		QD[i] = 1;
+		for (const Feature *f = prob_.x[i]; f->index != -1; ++f)
+		{
+			QD[i] += f->value * f->value;
+		}
+		index[i] = i;
+	}
+
+	Random rng(seed);
+	int active = length;
+	int passes = 0;
+	double PGmax_old = DBL_MAX;
+	double PGmin_old = -DBL_MAX;
+	double spread = 0;
+	stopReason = "passes";
+
+	while (passes < maxPasses)
+	{
+		++passes;
+		double PGmax_new = -DBL_MAX;
+		double PGmin_new = DBL_MAX;
+
+		rng.shuffle(&index[0], active);
+
+		for (int s = 0; s < active; s++)
+		{
+			int i = index[s];
+			const Feature *row = prob_.x[i];
+			double yi = prob_.y[i];
+
+			// gradient of the dual in alpha_i: y_i f(x_i) - 1
+			double G = yi * (dot(row, &w[0]) + bias) - 1;
+
+			double PG = 0;
+			if (alpha[i] == 0)
+			{
+				if (G > PGmax_old)
+				{
+					// at the lower bound and will stay there: shrink it
+					std::swap(index[s--], index[--active]);
+					continue;
+				}
+				if (G < 0)
+				{
+					PG = G;
+				}
+			}
+			else if (alpha[i] == cost)
+			{
+				if (G < PGmin_old)
+				{
+					std::swap(index[s--], index[--active]);
+					continue;
+				}
+				if (G > 0)
+				{
+					PG = G;
+				}
+			}
+			else
+			{
+				PG = G;
+			}
+
+			PGmax_new = std::max(PGmax_new, PG);
+			PGmin_new = std::min(PGmin_new, PG);
+
+			if (fabs(PG) > 1.0e-12)
+			{
+				double alphaold = alpha[i];
+				alpha[i] = std::min(std::max(alpha[i] - G / QD[i], 0.0), cost);
+				double d = (alpha[i] - alphaold) * yi;
+				for (const Feature *f = row; f->index != -1; ++f)
+				{
+					w[f->index - 1] += d * f->value;
+				}
+				bias += d;
+			}
+		}
+
+		spread = PGmax_new - PGmin_new;
+		if (spread <= eps)
+		{
+			if (active == length)
+			{
+				stopReason = "converged";
+				break;
+			}
+			// converged on the active set: check everything once more
+			active = length;
+			PGmax_old = DBL_MAX;
+			PGmin_old = -DBL_MAX;
+			continue;
+		}
+
+		PGmax_old = (PGmax_new <= 0) ? DBL_MAX : PGmax_new;
+		PGmin_old = (PGmin_new >= 0) ? -DBL_MAX : PGmin_new;
+	}
+
+	if (strcmp(stopReason, "passes") == 0)
+	{
+		fprintf(stderr, "dual coordinate descent stopped at the limit of %d passes, "
+				"projected gradients %g apart against a tolerance of %g\n", maxPasses, spread, eps);
+	}
+
+	b = -bias;
+	return passes;
+}
+
+double LinearSolver::objective() const
+{
+	double sum = 0;
+	for (size_t i = 0; i < alpha.size(); i++)
+	{
+		sum += alpha[i];
+	}
+	double norm = b * b;
+	for (size_t j = 0; j < w.size(); j++)
+	{
+		norm += w[j] * w[j];
+	}
+	return sum - norm / 2;
+}
+
+int LinearSolver::supportVectors() const
+{
+	int count = 0;
+	for (size_t i = 0; i < alpha.size(); i++)
+	{
+		count += alpha[i] > 0;
+	}
+	return count;
+}
+
+}
+;
+// namespace
@@ -0,0 +1,384 @@
+#include <mysvm.h>
+#include <model.h>
+
+namespace MySVM
+{
+
+void build_model(const Solver &solver, Model *model)
+{
+	model->kernelType = solver.kernelType;
+	model->gamma = solver.gamma;
+	model->features = solver.features;
+	model->b = solver.b;
+	model->w.clear();
+	model->coef.clear();
+	model->sv.clear();
+	model->map = FeatureMap();
+
+	if (solver.kernelType == KERNEL_LINEAR)
+	{
+		model->w.assign(solver.w, solver.w + (int) solver.features);
+		return;
+	}
+
+	// support vectors are stored sparsely, dropping the zeros of the dense rows, in input order
+	std::vector<int> rows((size_t) solver.length);
+	for (int k = 0; k < solver.length; k++)
+	{
+		rows[solver.order ? solver.order[k] : k] = k;
+	}
+	for (int k = 0; k < solver.length; k++)
+	{
+		int i = rows[k];
+		if (solver.alpha[i] > 0)
+		{
+			std::vector<Feature> row;
+			for (int j = 0; j < solver.features; j++)
+			{
+				if (solver.x[i][j] != 0)
+				{
+					Feature f = { j + 1, solver.x[i][j] };
+					row.push_back(f);
+				}
+			}
+			Feature end = { -1, 0 };
+			row.push_back(end);
+			model->coef.push_back(solver.y[i] * solver.alpha[i]);
+			model->sv.push_back(row);
+		}
+	}
+}
+
+void build_model(const LinearSolver &solver, Model *model)
+{
+	model->kernelType = KERNEL_LINEAR;
+	model->gamma = 0;
+	model->features = solver.w.size();
+	model->b = solver.b;
+	model->w = solver.w;
+	model->coef.clear();
+	model->sv.clear();
+	model->map = FeatureMap();
+}
+
+void build_model(const SGDSolver &solver, Model *model)
+{
+	model->kernelType = KERNEL_LINEAR;
+	model->gamma = 0;
+	model->features = solver.w.size();
+	model->b = solver.b;
+	model->w = solver.w;
+	model->coef.clear();
+	model->sv.clear();
+	model->map = FeatureMap();
+}
+
+void build_model(const Coordinator &coordinator, Model *model)
+{
+	const Problem &prob = coordinator.problem();
+	model->kernelType = coordinator.kernelType;
+	model->gamma = coordinator.gamma;
+	model->features = prob.features;
+	model->b = coordinator.b;
+	model->w.clear();
+	model->coef.clear();
+	model->sv.clear();
+	model->map = FeatureMap();
+
+	// w = sum_i y_i alpha_i x_i, or the support vectors as the sparse rows they were read as
+	if (coordinator.kernelType == KERNEL_LINEAR)
+	{
+		model->w.assign(prob.features, 0);
+	}
+	for (int i = 0; i < prob.length; i++)
+	{
+		if (coordinator.alpha[i] <= 0)
+		{
+			continue;
+		}
+		double coef = prob.y[i] * coordinator.alpha[i];
+		std::vector<Feature> row;
+		for (const Feature *f = prob.x[i]; f->index != -1; ++f)
+		{
+			if (coordinator.kernelType == KERNEL_LINEAR)
+			{
+				model->w[f->index - 1] += coef * f->value;
+			}
+			else
+			{
+				row.push_back(*f);
+			}
+		}
+		if (coordinator.kernelType != KERNEL_LINEAR)
+		{
+			Feature end = { -1, 0 };
+			row.push_back(end);
+			model->coef.push_back(coef);
+			model->sv.push_back(row);
+		}
+	}
+}
+
+void save_model(const char *filename, const Model &model, int precision)
+{
+	file out(filename);
+	char buf[64];
+
+	out.write(model.kernelType == KERNEL_LINEAR ? "kernel_type linear\n" : "kernel_type rbf\n");
+	if (model.kernelType == KERNEL_RBF)
+	{
+		snprintf(buf, sizeof(buf), "gamma %.*g\n", precision, model.gamma);
+		out.write(buf);
+	}
+	snprintf(buf, sizeof(buf), "features %d\nb %.*g\n", model.features, precision, model.b);
+	out.write(buf);
+
+	const FeatureMap &map = model.map;
+	if (map.type == MAP_RFF)
+	{
+		// omega and the phases are drawn again from the seed on loading
+		snprintf(buf, sizeof(buf), "map rff %d %d %.*g %llu\n", map.dim, map.features, precision,
+				map.gamma, (unsigned long long) map.seed);
+		out.write(buf);
+	}
+	else if (map.type == MAP_NYSTROEM)
+	{
+		snprintf(buf, sizeof(buf), "map nystroem %d %d %.*g\n", map.dim, map.features, precision, map.gamma);
+		out.write(buf);
+		for (int i = 0; i < map.dim; i++)
+		{
+			for (int p = 0; p <= i; p++)
+			{
+				snprintf(buf, sizeof(buf), p ? " %.*g" : "%.*g", precision, map.factor[(size_t) i * map.dim + p]);
+				out.write(buf);
+			}
+			out.write("\n");
+		}
+		for (int i = 0; i < map.dim; i++)
+		{
+			out.write("0");
+			for (const Feature *f = &map.landmarks[i][0]; f->index != -1; ++f)
+			{
+				snprintf(buf, sizeof(buf), " %d:%.*g", f->index, precision, f->value);
+				out.write(buf);
+			}
+			out.write("\n");
+		}
+	}
+
+	if (model.kernelType == KERNEL_LINEAR)
+	{
+		out.write("w\n");
+		for (size_t j = 0; j < model.w.size(); j++)
+		{
+			snprintf(buf, sizeof(buf), "%.*g\n", precision, model.w[j]);
+			out.write(buf);
+		}
+		return;
+	}
+
+	snprintf(buf, sizeof(buf), "SV %lu\n", (unsigned long) model.sv.size());
+	out.write(buf);
+	for (size_t k = 0; k < model.sv.size(); k++)
+	{
+		snprintf(buf, sizeof(buf), "%.*g", precision, model.coef[k]);
+		out.write(buf);
+		for (const Feature *f = &model.sv[k][0]; f->index != -1; ++f)
+		{
+			snprintf(buf, sizeof(buf), " %d:%.*g", f->index, precision, f->value);
+			out.write(buf);
+		}
+		out.write("\n");
+	}
+}
+
+/** \brief Reads the rest of a "map" line and, for Nystroem, the factor and landmark lines after it */
+static int load_map(FILE *fp, FeatureMap *map, char **line, size_t *size)
+{
+	char type[16];
+	if (fscanf(fp, " %15s %d %d %lf", type, &map->dim, &map->features, &map->gamma) != 4
+			|| map->dim <= 0 || map->features <= 0 || !(map->gamma > 0))
+	{
+		return 1;
+	}
+	if (strcmp(type, "rff") == 0)
+	{
+		unsigned long long seed;
+		if (fscanf(fp, " %llu", &seed) != 1)
+		{
+			return 1;
+		}
+		map->type = MAP_RFF;
+		map->seed = seed;
+	}
+	else if (strcmp(type, "nystroem") == 0)
+	{
+		map->type = MAP_NYSTROEM;
+		try
+		{
+			map->factor.assign((size_t) map->dim * map->dim, 0);
+		}
+		catch (const std::bad_alloc &e)
+		{
+			return 1;
+		}
+		for (int i = 0; i < map->dim; i++)
+		{
+			for (int p = 0; p <= i; p++)
+			{
+				if (fscanf(fp, "%lf", &map->factor[(size_t) i * map->dim + p]) != 1)
+				{
+					return 1;
+				}
+			}
+		}
+		if (fscanf(fp, " ") == EOF)
+		{
+			return 1;
+		}
+		map->landmarks.resize(map->dim);
+		for (int i = 0; i < map->dim; i++)
+		{
+			double label;
+			if (getline(line, size, fp) < 0 || parse_record(*line, &label, &map->landmarks[i]) != 0)
+			{
+				return 1;
+			}
+		}
+	}
+	else
+	{
+		return 1;
+	}
+
+	try
+	{
+		map->prepare();
+	}
+	catch (const std::bad_alloc &e)
+	{
+		return 1;
+	}
+	return 0;
+}
+
+int load_model(const char *filename, Model *model)
+{
+	FILE *fp = fopen(filename, "r");
+	if (fp == NULL)
+	{
+		return 1;
+	}
+
+	char kernel[16], word[16];
+	int status = 0;
+	model->gamma = 0;
+	model->w.clear();
+	model->coef.clear();
+	model->sv.clear();
+	model->map = FeatureMap();
+	char *line = NULL;
+	size_t size = 0;
+
+	if (fscanf(fp, " kernel_type %15s", kernel) != 1)
+	{
+		status = 1;
+	}
+	else if (strcmp(kernel, "rbf") == 0)
+	{
+		model->kernelType = KERNEL_RBF;
+		status = fscanf(fp, " gamma %lf", &model->gamma) != 1;
+	}
+	else
+	{
+		model->kernelType = KERNEL_LINEAR;
+		status = strcmp(kernel, "linear") != 0;
+	}
+
+	if (status == 0 && (fscanf(fp, " features %d b %lf", &model->features, &model->b) != 2
+			|| model->features < 0))
+	{
+		status = 1;
+	}
+
+	// the next word is map, w or SV
+	if (status == 0 && fscanf(fp, " %15s", word) != 1)
+	{
+		status = 1;
+	}
+	if (status == 0 && strcmp(word, "map") == 0)
+	{
+		status = load_map(fp, &model->map, &line, &size);
+		if (status == 0 && fscanf(fp, " %15s", word) != 1)
+		{
+			status = 1;
+		}
+	}
+
+	if (status == 0 && model->kernelType == KERNEL_LINEAR)
+	{
+		model->w.resize(model->features);
+		status = strcmp(word, "w") != 0;
+		for (int j = 0; status == 0 && j < model->features; j++)
+		{
+			status = fscanf(fp, "%lf", &model->w[j]) != 1;
+		}
+	}
+	else if (status == 0)
+	{
+		// each support vector is a libsvm record with its coefficient as the label
+		unsigned long count;
+		status = strcmp(word, "SV") != 0 || fscanf(fp, " %lu ", &count) != 1;
+		for (unsigned long k = 0; status == 0 && k < count; k++)
+		{
+			double coef;
+			std::vector<Feature> row;
+			if (getline(&line, &size, fp) < 0 || parse_record(line, &coef, &row) != 0)
+			{
+				status = 1;
+				break;
+			}
+			model->coef.push_back(coef);
+			model->sv.push_back(row);
+		}
+	}
+
+	free(line);
+	fclose(fp);
+	return status;
+}
+
+double decision_value(const Model &model, const Feature *x)
+{
+	double f = -model.b;
+	if (model.map.type != MAP_NONE)
+	{
+		std::vector<double> z(model.map.dim);
+		model.map.apply(x, z.data());
+		for (size_t j = 0; j < model.w.size() && j < z.size(); j++)
+		{
+			f += model.w[j] * z[j];
+		}
+		return f;
+	}
+	if (model.kernelType == KERNEL_LINEAR)
+	{
+		// features beyond the training data have weight 0
+		int features = model.w.size();
+		for (; x->index != -1 && x->index <= features; ++x)
+		{
+			f += model.w[x->index - 1] * x->value;
+		}
+		return f;
+	}
+
+	for (size_t k = 0; k < model.sv.size(); k++)
+	{
+		f += model.coef[k] * exp(-model.gamma * distance(&model.sv[k][0], x));
+	}
+	return f;
+}
+
+}
+;
+// namespace
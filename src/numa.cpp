@@ -0,0 +1,230 @@
+#include <mysvm.h>
+#include <numa.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <dirent.h>
+
+namespace MySVM
+{
+
+/** \brief Parses a cpulist ("0-3,8-11") into cpus */
+static void parse_cpulist(const char *list, std::vector<int> *cpus)
+{
+	for (const char *p = list; *p != '\0' && *p != '\n';)
+	{
+		char *end;
+		long first = strtol(p, &end, 10);
+		if (end == p)
+		{
+			return;
+		}
+		long last = first;
+		if (*end == '-')
+		{
+			p = end + 1;
+			last = strtol(p, &end, 10);
+			if (end == p)
+			{
+				return;
+			}
+		}
+		for (long cpu = first; cpu <= last; cpu++)
+		{
+			cpus->push_back((int) cpu);
+		}
+		p = end + (*end == ',');
+	}
+}
+
+Topology Topology::detect()
+{
+	Topology topology;
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+	{
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		{
+			CPU_SET(cpu, &allowed);
+		}
+	}
+
+	std::vector<int> ids;
+	DIR *dir = opendir("/sys/devices/system/node");
+	if (dir != NULL)
+	{
+		for (struct dirent *entry; (entry = readdir(dir)) != NULL;)
+		{
+			char *end;
+			if (strncmp(entry->d_name, "node", 4) == 0)
+			{
+				long id = strtol(entry->d_name + 4, &end, 10);
+				if (end != entry->d_name + 4 && *end == '\0')
+				{
+					ids.push_back((int) id);
+				}
+			}
+		}
+		closedir(dir);
+	}
+	std::sort(ids.begin(), ids.end());
+
+	for (size_t k = 0; k < ids.size(); k++)
+	{
+		char path[64], list[4096];
+		snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", ids[k]);
+		FILE *in = fopen(path, "r");
+		if (in == NULL)
+		{
+			continue;
+		}
+		std::vector<int> cpus, node;
+		if (fgets(list, sizeof(list), in) != NULL)
+		{
+			parse_cpulist(list, &cpus);
+		}
+		fclose(in);
+		for (size_t c = 0; c < cpus.size(); c++)
+		{
+			if (cpus[c] < CPU_SETSIZE && CPU_ISSET(cpus[c], &allowed))
+			{
+				node.push_back(cpus[c]);
+			}
+		}
+		// memory-only nodes and nodes outside the affinity mask take no threads
+		if (!node.empty())
+		{
+			topology.nodes.push_back(node);
+		}
+	}
+
+	// no NUMA information: one node with every cpu we may use
+	if (topology.nodes.empty())
+	{
+		std::vector<int> node;
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		{
+			if (CPU_ISSET(cpu, &allowed))
+			{
+				node.push_back(cpu);
+			}
+		}
+		if (node.empty())
+		{
+			node.push_back(0);
+		}
+		topology.nodes.push_back(node);
+	}
+	return topology;
+}
+
+int Topology::cpus() const
+{
+	int count = 0;
+	for (size_t k = 0; k < nodes.size(); k++)
+	{
+		count += (int) nodes[k].size();
+	}
+	return count;
+}
+
+int Topology::node(int cpu) const
+{
+	for (size_t k = 0; k < nodes.size(); k++)
+	{
+		if (std::binary_search(nodes[k].begin(), nodes[k].end(), cpu))
+		{
+			return (int) k;
+		}
+	}
+	return -1;
+}
+
+std::string Topology::describe() const
+{
+	std::string out;
+	for (size_t k = 0; k < nodes.size(); k++)
+	{
+		if (k > 0)
+		{
+			out += " | ";
+		}
+		// runs of consecutive cpus as first-last
+		const std::vector<int> &cpus = nodes[k];
+		for (size_t c = 0; c < cpus.size();)
+		{
+			size_t last = c;
+			while (last + 1 < cpus.size() && cpus[last + 1] == cpus[last] + 1)
+			{
+				++last;
+			}
+			char run[32];
+			if (last == c)
+			{
+				snprintf(run, sizeof(run), "%s%d", c > 0 ? "," : "", cpus[c]);
+			}
+			else
+			{
+				snprintf(run, sizeof(run), "%s%d-%d", c > 0 ? "," : "", cpus[c], cpus[last]);
+			}
+			out += run;
+			c = last + 1;
+		}
+	}
+	return out;
+}
+
+std::vector<int> bind_cpus(const Topology &topology, Binding binding, int threads)
+{
+	std::vector<int> order;
+	if (binding == BIND_NONE)
+	{
+		return order;
+	}
+
+	if (binding == BIND_COMPACT)
+	{
+		for (size_t k = 0; k < topology.nodes.size(); k++)
+		{
+			order.insert(order.end(), topology.nodes[k].begin(), topology.nodes[k].end());
+		}
+	}
+	else
+	{
+		// round robin over the nodes, each contributing its next cpu
+		for (size_t c = 0; (int) order.size() < topology.cpus(); c++)
+		{
+			for (size_t k = 0; k < topology.nodes.size(); k++)
+			{
+				if (c < topology.nodes[k].size())
+				{
+					order.push_back(topology.nodes[k][c]);
+				}
+			}
+		}
+	}
+
+	std::vector<int> cpus(threads);
+	for (int t = 0; t < threads; t++)
+	{
+		cpus[t] = order[t % order.size()];
+	}
+	return cpus;
+}
+
+int pin_thread(int cpu)
+{
+	if (cpu < 0 || cpu >= CPU_SETSIZE)
+	{
+		return EINVAL;
+	}
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+}
+;
+// namespace
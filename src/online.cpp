@@ -0,0 +1,461 @@
+#include <mysvm.h>
+#include <online.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+namespace MySVM
+{
+
+static volatile sig_atomic_t stopping = 0;
+
+static void stop(int)
+{
+	stopping = 1;
+}
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * \brief Splits a file descriptor into lines without blocking past a timeout
+ *
+ * stdio would block inside fgets() on a quiet pipe, so a partial mini-batch
+ * could wait for records indefinitely; reading the descriptor directly lets
+ * the caller flush it when the input goes idle.
+ */
+class LineReader {
+public:
+	LineReader(int fd, bool follow) :
+		fd_(fd), follow_(follow), eof_(false), pos_(0)
+	{
+	}
+
+	/** \brief Next line, without its newline
+	 * 	\return 1 for a line, 0 if none arrived within idleMs (or a signal came), -1 at the end of the stream
+	 */
+	int next(std::string *line, int idleMs)
+	{
+		while (1)
+		{
+			size_t newline = buf_.find('\n', pos_);
+			if (newline != std::string::npos)
+			{
+				line->assign(buf_, pos_, newline - pos_);
+				pos_ = newline + 1;
+				return 1;
+			}
+			buf_.erase(0, pos_);
+			pos_ = 0;
+
+			if (eof_)
+			{
+				if (buf_.empty())
+				{
+					return -1;
+				}
+				line->swap(buf_);
+				buf_.clear();
+				return 1;
+			}
+
+			struct pollfd p = { fd_, POLLIN, 0 };
+			int ready = poll(&p, 1, idleMs);
+			if (ready == 0 || (ready < 0 && errno == EINTR))
+			{
+				return 0;
+			}
+
+			char chunk[65536];
+			ssize_t n = read(fd_, chunk, sizeof(chunk));
+			if (n > 0)
+			{
+				buf_.append(chunk, n);
+			}
+			else if (n == 0 && follow_)
+			{
+				// end of a file that may still grow: wait like tail -f
+				struct timespec pause = { idleMs / 1000, (idleMs % 1000) * 1000000L };
+				nanosleep(&pause, NULL);
+				return 0;
+			}
+			else if (n == 0 || errno != EINTR)
+			{
+				eof_ = true;
+			}
+		}
+	}
+
+private:
+	int fd_;
+	bool follow_;
+	bool eof_;
+	std::string buf_;
+	size_t pos_;
+};
+
+OnlineSolver::OnlineSolver(KernelType kernelType, double gamma, double lambda, int budget) :
+	gamma(gamma), kernelType_(kernelType), lambda_(lambda), budget_(budget), t_(0), batches_(0), scale_(1),
+	bias_(0)
+{
+}
+
+double OnlineSolver::kernel(const Feature *a, double norm_a, int k) const
+{
+	double product = dot(a, &sv_[k][0]);
+	if (kernelType_ == KERNEL_RBF)
+	{
+		return exp(-gamma * (norm_a + norm_[k] - 2 * product));
+	}
+	return product;
+}
+
+double OnlineSolver::decision(const Feature *x) const
+{
+	double norm = (kernelType_ == KERNEL_RBF) ? dot(x, x) : 0;
+	double f = 0;
+	for (size_t k = 0; k < sv_.size(); k++)
+	{
+		f += coef_[k] * kernel(x, norm, k);
+	}
+	return scale_ * f + bias_;
+}
+
+void OnlineSolver::update(const Feature *const *rows, const double *y, const double *scores, int count)
+{
+	// Pegasos style mini-batch step, eta = 1 / (lambda t) for the t-th batch
+	t_ += count;
+	++batches_;
+	double eta = 1 / (lambda_ * batches_);
+	double decay = 1 - eta * lambda_;
+
+	if (decay <= 0)
+	{
+		sv_.clear();
+		coef_.clear();
+		norm_.clear();
+		scale_ = 1;
+	}
+	else
+	{
+		scale_ *= decay;
+	}
+
+	for (int k = 0; k < count; k++)
+	{
+		if (y[k] * scores[k] < 1)
+		{
+			const Feature *end = rows[k];
+			while ((end++)->index != -1)
+			{
+			}
+			sv_.push_back(std::vector<Feature>(rows[k], end));
+			coef_.push_back(eta * y[k] / count / scale_);
+			norm_.push_back(dot(rows[k], rows[k]));
+			// the bias is not decayed, so it takes the smaller steps of an
+			// unregularized SGD, 1 / sqrt(t)
+			bias_ += y[k] / count / sqrt((double) batches_);
+		}
+	}
+
+	// budget maintenance by removal: drop the support vector whose removal
+	// changes the model least, |coef|^2 K(sv, sv), from the class with more
+	// of them, so that neither class is pruned away
+	while ((int) sv_.size() > budget_)
+	{
+		int positive = 0;
+		for (size_t k = 0; k < coef_.size(); k++)
+		{
+			positive += coef_[k] > 0;
+		}
+		bool fromPositive = 2 * positive >= (int) coef_.size();
+		size_t smallest = coef_.size();
+		double least = HUGE_VAL;
+		for (size_t k = 0; k < coef_.size(); k++)
+		{
+			double weight = coef_[k] * coef_[k] * (kernelType_ == KERNEL_RBF ? 1 : norm_[k]);
+			if ((coef_[k] > 0) == fromPositive && weight < least)
+			{
+				smallest = k;
+				least = weight;
+			}
+		}
+		sv_[smallest].swap(sv_.back());
+		coef_[smallest] = coef_.back();
+		norm_[smallest] = norm_.back();
+		sv_.pop_back();
+		coef_.pop_back();
+		norm_.pop_back();
+	}
+
+	if (scale_ < 1e-9)
+	{
+		rescale();
+	}
+}
+
+void OnlineSolver::rescale()
+{
+	for (size_t k = 0; k < coef_.size(); k++)
+	{
+		coef_[k] *= scale_;
+	}
+	scale_ = 1;
+}
+
+void OnlineSolver::build(Model *model) const
+{
+	int features = 0;
+	for (size_t k = 0; k < sv_.size(); k++)
+	{
+		for (const Feature *f = &sv_[k][0]; f->index != -1; ++f)
+		{
+			features = std::max(features, f->index);
+		}
+	}
+
+	model->kernelType = kernelType_;
+	model->gamma = gamma;
+	model->features = features;
+	model->b = 0;
+	model->w.clear();
+	model->coef.clear();
+	model->sv.clear();
+
+	model->b = -bias_;
+
+	if (kernelType_ == KERNEL_LINEAR)
+	{
+		model->w.assign(features, 0);
+		for (size_t k = 0; k < sv_.size(); k++)
+		{
+			for (const Feature *f = &sv_[k][0]; f->index != -1; ++f)
+			{
+				model->w[f->index - 1] += scale_ * coef_[k] * f->value;
+			}
+		}
+		return;
+	}
+
+	for (size_t k = 0; k < sv_.size(); k++)
+	{
+		model->coef.push_back(scale_ * coef_[k]);
+		model->sv.push_back(sv_[k]);
+	}
+}
+
+/**
+ * \brief Latencies counted in buckets of an eighth of an octave from 1 us up,
+ * so that percentiles come out within 9% in constant memory however long the
+ * stream runs, and the progress windows merge into the total by adding counts
+ */
+struct LatencyHistogram {
+	enum { PER_OCTAVE = 8, BUCKETS = 40 * PER_OCTAVE };	// up to 2^40 us, about 12 days
+
+	long counts[BUCKETS];	// bucket b > 0 holds (2^((b - 1) / 8), 2^(b / 8)] us, bucket 0 up to 1 us
+
+	LatencyHistogram() { memset(counts, 0, sizeof(counts)); }
+
+	void add(double seconds)
+	{
+		int b = (seconds > 1e-6) ? (int) (PER_OCTAVE * log2(seconds * 1e6)) + 1 : 0;
+		++counts[std::min(b, (int) BUCKETS - 1)];
+	}
+
+	void add(const LatencyHistogram &other)
+	{
+		for (int b = 0; b < BUCKETS; b++)
+		{
+			counts[b] += other.counts[b];
+		}
+	}
+
+	/** \brief Upper end of the bucket holding the q quantile of the records counted */
+	double quantile(double q, long records) const
+	{
+		long rank = std::max((long) ceil(q * records), 1L);
+		long seen = 0;
+		int b = 0;
+		while (b < BUCKETS - 1 && (seen += counts[b]) < rank)
+		{
+			++b;
+		}
+		return 1e-6 * exp2((double) b / PER_OCTAVE);
+	}
+};
+
+/** \brief Throughput and latency (seconds from a record's arrival to the end of its update) */
+struct StreamStats {
+	long records;
+	long mistakes;		// records misclassified before their update
+	double sum;
+	double worst;
+	LatencyHistogram latency;
+
+	StreamStats() : records(0), mistakes(0), sum(0), worst(0) {}
+
+	void add(double seconds)
+	{
+		++records;
+		sum += seconds;
+		worst = std::max(worst, seconds);
+		latency.add(seconds);
+	}
+
+	void add(const StreamStats &other)
+	{
+		records += other.records;
+		mistakes += other.mistakes;
+		sum += other.sum;
+		worst = std::max(worst, other.worst);
+		latency.add(other.latency);
+	}
+
+	void print(const char *what, double seconds, int svs) const
+	{
+		if (records == 0)
+		{
+			return;
+		}
+		// the bucket's upper end can lie above the largest latency itself
+		double p99 = std::min(latency.quantile(0.99, records), worst);
+		printf("online %s: %ld records, %.0f records/s, latency mean %.3f ms p99 %.3f ms max %.3f ms, "
+				"%d support vectors, %.2f%% progressive accuracy\n", what, records,
+				records / std::max(seconds, 1e-9), 1e3 * sum / records, 1e3 * p99, 1e3 * worst, svs,
+				100.0 * (records - mistakes) / records);
+		fflush(stdout);
+	}
+};
+
+int runOnline(const char *path, const OnlineOptions &options)
+{
+	int fd = (strcmp(path, "-") == 0) ? 0 : open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		fprintf(stderr, "can't open input file %s\n", path);
+		return 1;
+	}
+
+	// no SA_RESTART, so that a signal also wakes up poll() and read()
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stop;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	OnlineSolver solver(options.kernelType, options.gamma, options.lambda, options.budget);
+	LineReader reader(fd, options.follow);
+	int batch = std::max(options.batch, 1);
+
+	std::vector< std::vector<Feature> > rows(batch);
+	std::vector<const Feature *> pointers(batch);
+	std::vector<double> y(batch), scores(batch), arrival(batch);
+	StreamStats total, window;
+	long malformed = 0;
+	double first = 0, last = 0, windowStart = 0;
+	int count = 0;
+
+	std::string line;
+	while (1)
+	{
+		int status = stopping ? -1 : reader.next(&line, 10);
+		if (status == 1)
+		{
+			if (parse_record(&line[0], &y[count], &rows[count]) != 0)
+			{
+				++malformed;
+				continue;
+			}
+			arrival[count] = now();
+			if (first == 0)
+			{
+				first = windowStart = last = arrival[count];
+			}
+			++count;
+		}
+
+		// update when the batch is full, or early when the input goes quiet or ends
+		if (count == batch || (status != 1 && count > 0))
+		{
+			if (solver.gamma <= 0)
+			{
+				int features = 1;
+				for (int k = 0; k < count; k++)
+				{
+					for (size_t f = 0; f + 1 < rows[k].size(); f++)
+					{
+						features = std::max(features, rows[k][f].index);
+					}
+				}
+				solver.gamma = 1.0 / features;
+			}
+
+			for (int k = 0; k < count; k++)
+			{
+				pointers[k] = &rows[k][0];
+				scores[k] = solver.decision(pointers[k]);
+				window.mistakes += y[k] * scores[k] <= 0;
+			}
+			solver.update(&pointers[0], &y[0], &scores[0], count);
+
+			last = now();
+			for (int k = 0; k < count; k++)
+			{
+				window.add(last - arrival[k]);
+			}
+			count = 0;
+
+			if (options.report > 0 && window.records >= options.report)
+			{
+				window.print("progress", last - windowStart, solver.size());
+				total.add(window);
+				window = StreamStats();
+				windowStart = last;
+			}
+		}
+
+		if (status < 0)
+		{
+			break;
+		}
+	}
+
+	total.add(window);
+	total.print("total", last - first, solver.size());
+	if (malformed > 0)
+	{
+		printf("online: skipped %ld malformed records\n", malformed);
+	}
+
+	if (fd != 0)
+	{
+		close(fd);
+	}
+
+	if (options.model_file != NULL)
+	{
+		Model model;
+		solver.build(&model);
+		try
+		{
+			save_model(options.model_file, model);
+		}
+		catch (const std::runtime_error &e)
+		{
+			fprintf(stderr, "can't write model file %s\n", options.model_file);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+}
+;
+// namespace
@@ -0,0 +1,390 @@
+#include <mysvm.h>
+#include <problem.h>
+#include <dataset.h>
+#include <thread_pool.h>
+#include <stdint.h>
+#include <ctype.h>
+#define Malloc(type,n) (type *)malloc((n)*sizeof(type))
+
+namespace MySVM
+{
+
+Problem::Problem() :
+	length(0), features(0), elements(0), y(NULL), x(NULL), space(NULL)
+{
+}
+
+Problem::~Problem()
+{
+	free(y);
+	free(x);
+	free(space);
+}
+
+size_t Problem::bytes() const
+{
+	size_t rows = length * (sizeof(double) + sizeof(Feature *));
+	return space ? rows + (elements + length) * sizeof(Feature) : rows;
+}
+
+static char* readline(FILE *input, char **line, int *max_line_len)
+{
+	int len;
+
+	if (fgets(*line, *max_line_len, input) == NULL)
+		return NULL;
+
+	while (strrchr(*line, '\n') == NULL)
+	{
+		*max_line_len *= 2;
+		*line = (char *) realloc(*line, *max_line_len);
+		len = (int) strlen(*line);
+		if (fgets(*line + len, *max_line_len - len, input) == NULL)
+			break;
+	}
+	return *line;
+}
+
+// read in a binary dataset written by svm_gen -b (see dataset.h)
+static int read_problem_binary(FILE *fp, Problem *prob)
+{
+	DatasetHeader header;
+	if (fread(&header, sizeof(header), 1, fp) != 1 || header.version != DATASET_VERSION)
+		return 1;
+
+	prob->length = header.rows;
+	prob->features = header.features;
+	prob->elements = header.nnz;
+
+	uint64_t *rowptr = Malloc(uint64_t, header.rows + 1);
+	int32_t *index = Malloc(int32_t, header.nnz);
+	double *value = Malloc(double, header.nnz);
+
+	prob->y = Malloc(double, header.rows);
+	prob->x = Malloc(Feature *, header.rows);
+	prob->space = Malloc(Feature, header.nnz + header.rows);
+
+	int status = 0;
+	if (fread(prob->y, sizeof(double), header.rows, fp) != header.rows
+			|| fread(rowptr, sizeof(uint64_t), header.rows + 1, fp) != header.rows + 1
+			|| fread(index, sizeof(int32_t), header.nnz, fp) != header.nnz
+			|| fread(value, sizeof(double), header.nnz, fp) != header.nnz
+			|| rowptr[header.rows] != header.nnz)
+	{
+		status = 1;
+	}
+
+	// the rows must tile [0, nnz) in order, or they would overlap or run past the arrays
+	for (uint64_t i = 0; status == 0 && i < header.rows; i++)
+	{
+		if ((i == 0 && rowptr[0] != 0) || rowptr[i] > rowptr[i + 1] || rowptr[i + 1] > header.nnz)
+		{
+			status = 1;
+		}
+	}
+
+	Feature *next = prob->space;
+	for (uint64_t i = 0; status == 0 && i < header.rows; i++)
+	{
+		prob->x[i] = next;
+		int last = 0;
+		for (uint64_t k = rowptr[i]; k < rowptr[i + 1]; k++)
+		{
+			if (index[k] <= last || (uint64_t) index[k] > header.features)
+			{
+				status = 1;
+				break;
+			}
+			last = index[k];
+			next->index = index[k];
+			next->value = value[k];
+			++next;
+		}
+		(next++)->index = -1;
+	}
+
+	free(rowptr);
+	free(index);
+	free(value);
+	return status;
+}
+
+// read in a problem (in svmlight format)
+int read_problem(const char *filename, Problem *prob)
+{
+	int max_index, inst_max_index, i;
+	FILE *fp = fopen(filename, "r");
+	char *endptr;
+	char *idx, *val, *label;
+
+	prob->length = 0;
+	prob->features = 0;
+	prob->elements = 0;
+
+	if (fp == NULL)
+	{
+		fprintf(stderr, "can't open input file %s\n", filename);
+		exit(1);
+	}
+
+	DatasetHeader header;
+	if (fread(&header, sizeof(header), 1, fp) == 1 && is_binary_dataset(header))
+	{
+		rewind(fp);
+		int status = read_problem_binary(fp, prob);
+		fclose(fp);
+		return status;
+	}
+	rewind(fp);
+
+	// first pass: count the rows and stored features, find the largest index
+	int max_line_len = 1024;
+	char *line = Malloc(char,max_line_len);
+	max_index = 0;
+	while (readline(fp, &line, &max_line_len) != NULL)
+	{
+		char *p = strtok(line, " \t"); // label
+
+		// features
+		while (1)
+		{
+			idx = strtok(NULL, ":");
+			val = strtok(NULL, " \t");
+			if (val == NULL)
+				break;
+
+			++prob->elements;
+			inst_max_index = (int) strtol(idx, &endptr, 10);
+			if (inst_max_index > max_index)
+				max_index = inst_max_index;
+		}
+		if (p != NULL)
+			++prob->length;
+	}
+	rewind(fp);
+
+	prob->features = max_index;
+	prob->y = Malloc(double, prob->length);
+	prob->x = Malloc(Feature *, prob->length);
+	prob->space = Malloc(Feature, prob->elements + prob->length);
+
+	int status = 0;
+	Feature *next = prob->space;
+	for (i = 0; status == 0 && i < prob->length; i++)
+	{
+		inst_max_index = 0; // strtol gives 0 if wrong format
+		readline(fp, &line, &max_line_len);
+		prob->x[i] = next;
+		label = strtok(line, " \t\n");
+		if (label == NULL) // empty line
+		{
+			status = 1;
+			break;
+		}
+
+		prob->y[i] = strtod(label, &endptr);
+		if (endptr == label || *endptr != '\0')
+		{
+			status = 1;
+			break;
+		}
+
+		while (1)
+		{
+			idx = strtok(NULL, ":");
+			val = strtok(NULL, " \t");
+
+			if (val == NULL)
+				break;
+
+			int index = (int) strtol(idx, &endptr, 10);
+			if (endptr == idx || *endptr != '\0' || index <= inst_max_index)
+			{
+				status = 1;
+				break;
+			}
+			else
+				inst_max_index = index;
+
+			next->index = index;
+			next->value = strtod(val, &endptr);
+			++next;
+			if (endptr == val || (*endptr != '\0' && !isspace(*endptr)))
+			{
+				status = 1;
+				break;
+			}
+		}
+		(next++)->index = -1;
+	}
+
+	free(line);
+	fclose(fp);
+	return status;
+}
+
+void write_problem(const char *filename, const Problem &prob, bool binary, int precision)
+{
+	FILE *fp = fopen(filename, binary ? "wb" : "w");
+	if (fp == NULL)
+		throw std::runtime_error("file open failure");
+
+	bool ok = true;
+	if (binary)
+	{
+		DatasetHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC));
+		header.version = DATASET_VERSION;
+		header.rows = prob.length;
+		header.features = prob.features;
+		header.nnz = prob.elements;
+
+		std::vector<uint64_t> rowptr(prob.length + 1, 0);
+		std::vector<int32_t> index;
+		std::vector<double> value;
+		index.reserve(prob.elements);
+		value.reserve(prob.elements);
+		for (int i = 0; i < prob.length; i++)
+		{
+			for (const Feature *f = prob.x[i]; f->index != -1; ++f)
+			{
+				index.push_back(f->index);
+				value.push_back(f->value);
+			}
+			rowptr[i + 1] = index.size();
+		}
+
+		ok = fwrite(&header, sizeof(header), 1, fp) == 1
+				&& fwrite(prob.y, sizeof(double), prob.length, fp) == (size_t) prob.length
+				&& fwrite(&rowptr[0], sizeof(uint64_t), rowptr.size(), fp) == rowptr.size()
+				&& fwrite(index.data(), sizeof(int32_t), index.size(), fp) == index.size()
+				&& fwrite(value.data(), sizeof(double), value.size(), fp) == value.size();
+	}
+	else
+	{
+		for (int i = 0; ok && i < prob.length; i++)
+		{
+			ok = fprintf(fp, "%.*g", precision, prob.y[i]) > 0;
+			for (const Feature *f = prob.x[i]; ok && f->index != -1; ++f)
+			{
+				ok = fprintf(fp, " %d:%.*g", f->index, precision, f->value) > 0;
+			}
+			ok = ok && fputc('\n', fp) != EOF;
+		}
+	}
+
+	if (fclose(fp) != 0 || !ok)
+		throw std::runtime_error("file write failure");
+}
+
+void subset_problem(const Problem &prob, const std::vector<int> &rows, Problem *out)
+{
+	free(out->y);
+	free(out->x);
+	free(out->space);
+	out->length = rows.size();
+	out->features = prob.features;
+	out->elements = 0;
+	out->y = Malloc(double, rows.size());
+	out->x = Malloc(Feature *, rows.size());
+	out->space = NULL;
+
+	for (size_t k = 0; k < rows.size(); k++)
+	{
+		out->y[k] = prob.y[rows[k]];
+		out->x[k] = prob.x[rows[k]];
+		for (const Feature *f = out->x[k]; f->index != -1; ++f)
+		{
+			++out->elements;
+		}
+	}
+}
+
+int parse_record(char *line, double *label, std::vector<Feature> *row)
+{
+	char *endptr;
+	row->clear();
+
+	char *text = strtok(line, " \t\n");
+	if (text == NULL)
+		return 1;
+
+	*label = strtod(text, &endptr);
+	if (endptr == text || *endptr != '\0')
+		return 1;
+
+	int last = 0;
+	while (1)
+	{
+		char *idx = strtok(NULL, ":");
+		char *val = strtok(NULL, " \t\n");
+		if (val == NULL)
+			break;
+
+		Feature f;
+		f.index = (int) strtol(idx, &endptr, 10);
+		if (endptr == idx || *endptr != '\0' || f.index <= last)
+			return 1;
+		last = f.index;
+
+		f.value = strtod(val, &endptr);
+		if (endptr == val || (*endptr != '\0' && !isspace(*endptr)))
+			return 1;
+		row->push_back(f);
+	}
+
+	Feature end = { -1, 0 };
+	row->push_back(end);
+	return 0;
+}
+
+double **densify(const Problem &prob, double **space, ThreadPool *pool, PageBlock *block, PageMode pages)
+{
+	size_t M = (size_t) prob.features;
+	bool clear = pool != NULL || block != NULL;
+	if (block != NULL)
+	{
+		*space = static_cast<double *>(block->allocate((size_t) prob.length * M * sizeof(double), pages));
+	}
+	else if (pool == NULL)
+	{
+		*space = (double *) calloc((size_t) prob.length * M, sizeof(double));
+	}
+	else
+	{
+		// left untouched here; each thread clears and fills its own rows
+		*space = Malloc(double, (size_t) prob.length * M);
+	}
+	double **rows = Malloc(double *, prob.length);
+	ThreadPool::Job job = [&](int thread, int threads)
+	{
+		long begin, end;
+		ThreadPool::range(prob.length, thread, threads, &begin, &end);
+		if (clear && end > begin)
+		{
+			memset(&(*space)[begin * M], 0, (end - begin) * M * sizeof(double));
+		}
+		for (long i = begin; i < end; i++)
+		{
+			rows[i] = &(*space)[i * M];
+			for (const Feature *f = prob.x[i]; f->index != -1; ++f)
+			{
+				rows[i][f->index - 1] = f->value;
+			}
+		}
+	};
+	if (pool != NULL)
+	{
+		pool->run(job);
+	}
+	else
+	{
+		job(0, 1);
+	}
+	return rows;
+}
+
+}
+;
+// namespace
@@ -0,0 +1,256 @@
+#include <mysvm.h>
+#include <quantized_rows.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QUANTIZED_X86
+#endif
+
+#define QUANTIZED_CHUNK 32768	// bytes summed in int32 lanes before the lanes are flushed
+#define FLOAT_CHUNK 1024		// bytes summed in float lanes before the lanes are flushed
+
+namespace MySVM
+{
+
+QuantizedRows::QuantizedRows() :
+	length(0), features(0), stride(0), uniform(true), scale(0), maxError(0),
+	data_(NULL), weight_(NULL), sum_(NULL), norm_(NULL), dot_(dotScalar), kernelName_("scalar")
+{
+}
+
+void QuantizedRows::build(double *const *x, int length, int features)
+{
+	this->length = length;
+	this->features = features;
+	stride = (features + 63) & ~63;
+
+	// s_j = max_i |x_ij| / 127; features that are 0 everywhere don't count against uniform
+	std::vector<double> step(features, 0);
+	for (int i = 0; i < length; i++)
+	{
+		for (int j = 0; j < features; j++)
+		{
+			step[j] = std::max(step[j], fabs(x[i][j]));
+		}
+	}
+	double common = 0;
+	uniform = true;
+	for (int j = 0; j < features; j++)
+	{
+		step[j] /= 127;
+		if (step[j] > 0 && common == 0)
+		{
+			common = step[j];
+		}
+		uniform = uniform && (step[j] == 0 || step[j] == common);
+	}
+	scale = uniform ? common : 0;
+
+	// the arena is zeroed, so the padding of the rows and weights is 0
+	arena_.reset(Arena::align((size_t) length * stride) + Arena::align(stride * sizeof(float))
+			+ Arena::align(length * sizeof(int32_t)) + Arena::align(length * sizeof(double)));
+	int8_t *q = arena_.allocate<int8_t>((size_t) length * stride);
+	float *weight = arena_.allocate<float>(stride);
+	int32_t *sum = arena_.allocate<int32_t>(length);
+	double *norm = arena_.allocate<double>(length);
+	for (int j = 0; j < features; j++)
+	{
+		weight[j] = (float) (step[j] * step[j]);
+	}
+	maxError = 0;
+	for (int i = 0; i < length; i++)
+	{
+		int8_t *row = q + (size_t) i * stride;
+		for (int j = 0; j < features; j++)
+		{
+			long v = (step[j] > 0) ? lrint(x[i][j] / step[j]) : 0;
+			row[j] = (int8_t) std::max(-127L, std::min(127L, v));
+			sum[i] += row[j];
+			maxError = std::max(maxError, fabs(x[i][j] - row[j] * step[j]));
+		}
+	}
+	data_ = q;
+	weight_ = weight;
+	sum_ = sum;
+
+	dot_ = dotScalar;
+	kernelName_ = "scalar";
+#ifdef QUANTIZED_X86
+	__builtin_cpu_init();
+	if (uniform && __builtin_cpu_supports("avxvnni"))
+	{
+		dot_ = dotAvxVnni;
+		kernelName_ = "avx-vnni";
+	}
+	else if (uniform && __builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512vl"))
+	{
+		dot_ = dotAvx512Vnni;
+		kernelName_ = "avx512-vnni";
+	}
+	else if (uniform && __builtin_cpu_supports("avx2"))
+	{
+		dot_ = dotAvx2;
+		kernelName_ = "avx2";
+	}
+	else if (!uniform && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+	{
+		dot_ = dotAvx2Fma;
+		kernelName_ = "avx2-fma";
+	}
+#endif
+
+	for (int i = 0; i < length; i++)
+	{
+		norm[i] = dot_(*this, i, i);
+	}
+	norm_ = norm;
+}
+
+double QuantizedRows::dotScalar(const QuantizedRows &rows, int i, int k)
+{
+	const int8_t *a = rows.data_ + (size_t) i * rows.stride;
+	const int8_t *b = rows.data_ + (size_t) k * rows.stride;
+	if (rows.uniform)
+	{
+		int64_t total = 0;
+		for (int j = 0; j < rows.features; j++)
+		{
+			total += a[j] * b[j];
+		}
+		return total * rows.scale * rows.scale;
+	}
+	double total = 0;
+	for (int j = 0; j < rows.features; j++)
+	{
+		total += (double) rows.weight_[j] * (a[j] * b[j]);
+	}
+	return total;
+}
+
+#ifdef QUANTIZED_X86
+
+__attribute__((target("avx2")))
+static inline int64_t sum_lanes(__m256i v)
+{
+	__m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+	return _mm_cvtsi128_si32(s);
+}
+
+__attribute__((target("avx2")))
+static inline double sum_lanes(__m256 v)
+{
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+	return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2")))
+double QuantizedRows::dotAvx2(const QuantizedRows &rows, int i, int k)
+{
+	const int8_t *a = rows.data_ + (size_t) i * rows.stride;
+	const int8_t *b = rows.data_ + (size_t) k * rows.stride;
+	int64_t total = 0;
+	for (int first = 0; first < rows.stride; first += QUANTIZED_CHUNK)
+	{
+		int last = std::min(first + QUANTIZED_CHUNK, rows.stride);
+		__m256i acc = _mm256_setzero_si256();
+		for (int j = first; j < last; j += 16)
+		{
+			// sign extended to int16, multiplied and added in pairs to int32
+			__m256i va = _mm256_cvtepi8_epi16(_mm_load_si128((const __m128i *) (a + j)));
+			__m256i vb = _mm256_cvtepi8_epi16(_mm_load_si128((const __m128i *) (b + j)));
+			acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+		}
+		total += sum_lanes(acc);
+	}
+	return total * rows.scale * rows.scale;
+}
+
+__attribute__((target("avx2,avxvnni")))
+double QuantizedRows::dotAvxVnni(const QuantizedRows &rows, int i, int k)
+{
+	const int8_t *a = rows.data_ + (size_t) i * rows.stride;
+	const int8_t *b = rows.data_ + (size_t) k * rows.stride;
+	const __m256i bias = _mm256_set1_epi8((char) 0x80);
+	int64_t total = 0;
+	for (int first = 0; first < rows.stride; first += QUANTIZED_CHUNK)
+	{
+		int last = std::min(first + QUANTIZED_CHUNK, rows.stride);
+		__m256i acc = _mm256_setzero_si256();
+		for (int j = first; j < last; j += 32)
+		{
+			// vpdpbusd multiplies unsigned by signed bytes: a + 128 adds 128 sum_j b_j, taken off below
+			__m256i va = _mm256_xor_si256(_mm256_load_si256((const __m256i *) (a + j)), bias);
+			__m256i vb = _mm256_load_si256((const __m256i *) (b + j));
+			acc = _mm256_dpbusd_avx_epi32(acc, va, vb);
+		}
+		total += sum_lanes(acc);
+	}
+	total -= 128 * (int64_t) rows.sum_[k];
+	return total * rows.scale * rows.scale;
+}
+
+__attribute__((target("avx2,avx512f,avx512vl,avx512vnni")))
+double QuantizedRows::dotAvx512Vnni(const QuantizedRows &rows, int i, int k)
+{
+	const int8_t *a = rows.data_ + (size_t) i * rows.stride;
+	const int8_t *b = rows.data_ + (size_t) k * rows.stride;
+	const __m256i bias = _mm256_set1_epi8((char) 0x80);
+	int64_t total = 0;
+	for (int first = 0; first < rows.stride; first += QUANTIZED_CHUNK)
+	{
+		int last = std::min(first + QUANTIZED_CHUNK, rows.stride);
+		__m256i acc = _mm256_setzero_si256();
+		for (int j = first; j < last; j += 32)
+		{
+			// as dotAvxVnni, in the EVEX encoding
+			__m256i va = _mm256_xor_si256(_mm256_load_si256((const __m256i *) (a + j)), bias);
+			__m256i vb = _mm256_load_si256((const __m256i *) (b + j));
+			acc = _mm256_dpbusd_epi32(acc, va, vb);
+		}
+		total += sum_lanes(acc);
+	}
+	total -= 128 * (int64_t) rows.sum_[k];
+	return total * rows.scale * rows.scale;
+}
+
+__attribute__((target("avx2,fma")))
+double QuantizedRows::dotAvx2Fma(const QuantizedRows &rows, int i, int k)
+{
+	const int8_t *a = rows.data_ + (size_t) i * rows.stride;
+	const int8_t *b = rows.data_ + (size_t) k * rows.stride;
+	double total = 0;
+	for (int first = 0; first < rows.stride; first += FLOAT_CHUNK)
+	{
+		int last = std::min(first + FLOAT_CHUNK, rows.stride);
+		__m256 acc = _mm256_setzero_ps();
+		for (int j = first; j < last; j += 16)
+		{
+			// 16 exact int16 products, widened to floats and weighted by s_j^2
+			__m256i va = _mm256_cvtepi8_epi16(_mm_load_si128((const __m128i *) (a + j)));
+			__m256i vb = _mm256_cvtepi8_epi16(_mm_load_si128((const __m128i *) (b + j)));
+			__m256i p = _mm256_mullo_epi16(va, vb);
+			__m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(p)));
+			__m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(p, 1)));
+			acc = _mm256_fmadd_ps(lo, _mm256_load_ps(rows.weight_ + j), acc);
+			acc = _mm256_fmadd_ps(hi, _mm256_load_ps(rows.weight_ + j + 8), acc);
+		}
+		total += sum_lanes(acc);
+	}
+	return total;
+}
+
+#else
+
+double QuantizedRows::dotAvx2(const QuantizedRows &rows, int i, int k) { return dotScalar(rows, i, k); }
+double QuantizedRows::dotAvx2Fma(const QuantizedRows &rows, int i, int k) { return dotScalar(rows, i, k); }
+double QuantizedRows::dotAvxVnni(const QuantizedRows &rows, int i, int k) { return dotScalar(rows, i, k); }
+double QuantizedRows::dotAvx512Vnni(const QuantizedRows &rows, int i, int k) { return dotScalar(rows, i, k); }
+
+#endif
+
+}
+;
+// namespace
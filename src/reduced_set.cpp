@@ -0,0 +1,205 @@
+#include <mysvm.h>
+#include <reduced_set.h>
+#include <float.h>
+
+namespace MySVM
+{
+
+/**	\brief Best merge of two vectors of the same sign at squared distance d
+ * 	\param a, c |alpha_m| and |alpha_n|
+ * 	\param h set to the weight of x_m in z = h x_m + (1 - h) x_n
+ * 	\return |alpha_z| = max_h a K(x_m, z) + c K(x_n, z)
+ */
+static double merge(double a, double c, double gamma, double d, double *h)
+{
+	// K(x_m, z) = exp(-gamma d (1 - h)^2), K(x_n, z) = exp(-gamma d h^2); unimodal on [0, 1]
+	const double ratio = 0.6180339887498949;
+	double lo = 0, hi = 1;
+	double h1 = hi - ratio * (hi - lo);
+	double h2 = lo + ratio * (hi - lo);
+	double f1 = a * exp(-gamma * d * (1 - h1) * (1 - h1)) + c * exp(-gamma * d * h1 * h1);
+	double f2 = a * exp(-gamma * d * (1 - h2) * (1 - h2)) + c * exp(-gamma * d * h2 * h2);
+	for (int k = 0; k < 40; k++)
+	{
+		if (f1 < f2)
+		{
+			lo = h1;
+			h1 = h2;
+			f1 = f2;
+			h2 = lo + ratio * (hi - lo);
+			f2 = a * exp(-gamma * d * (1 - h2) * (1 - h2)) + c * exp(-gamma * d * h2 * h2);
+		}
+		else
+		{
+			hi = h2;
+			h2 = h1;
+			f2 = f1;
+			h1 = hi - ratio * (hi - lo);
+			f1 = a * exp(-gamma * d * (1 - h1) * (1 - h1)) + c * exp(-gamma * d * h1 * h1);
+		}
+	}
+	*h = (f1 > f2) ? h1 : h2;
+	return std::max(f1, f2);
+}
+
+/**	\brief |alpha_z| / (|alpha_m| + |alpha_n|) of the best merge on a grid of
+ * 	m = |alpha_m| / (|alpha_m| + |alpha_n|) and K(x_m, x_n) in [0, 1]
+ *
+ * The merged coefficient only depends on these two, so the partners of a vector
+ * are ranked by interpolating the grid instead of searching h for each one.
+ */
+class MergeTable
+{
+public:
+	static const int STEPS = 100;
+
+	MergeTable() :
+		value_((STEPS + 1) * (STEPS + 1))
+	{
+		for (int i = 0; i <= STEPS; i++)
+		{
+			for (int j = 0; j <= STEPS; j++)
+			{
+				// K = exp(-d) with gamma 1; K = 0 is taken as the smallest positive double
+				double h;
+				double d = -log(std::max((double) j / STEPS, DBL_MIN));
+				value_[i * (STEPS + 1) + j] = merge((double) i / STEPS, 1 - (double) i / STEPS, 1, d, &h);
+			}
+		}
+	}
+
+	/** \brief Bilinear interpolation at m and k in [0, 1] */
+	double operator()(double m, double k) const
+	{
+		double x = m * STEPS, y = k * STEPS;
+		int i = std::min((int) x, STEPS - 1), j = std::min((int) y, STEPS - 1);
+		double u = x - i, v = y - j;
+		const double *row = &value_[i * (STEPS + 1) + j];
+		return (1 - u) * ((1 - v) * row[0] + v * row[1])
+				+ u * ((1 - v) * row[STEPS + 1] + v * row[STEPS + 2]);
+	}
+
+private:
+	std::vector<double> value_;
+};
+
+/** \brief h a + (1 - h) b of two sparse rows */
+static std::vector<Feature> combine(const Feature *a, const Feature *b, double h)
+{
+	std::vector<Feature> z;
+	while (a->index != -1 || b->index != -1)
+	{
+		Feature f;
+		if (a->index == b->index)
+		{
+			f.index = a->index;
+			f.value = h * (a++)->value + (1 - h) * (b++)->value;
+		}
+		else if (b->index == -1 || (a->index != -1 && a->index < b->index))
+		{
+			f.index = a->index;
+			f.value = h * (a++)->value;
+		}
+		else
+		{
+			f.index = b->index;
+			f.value = (1 - h) * (b++)->value;
+		}
+		z.push_back(f);
+	}
+	Feature end = { -1, 0 };
+	z.push_back(end);
+	return z;
+}
+
+int reduce_model(Model *model, int budget, double *error)
+{
+	std::vector< std::vector<Feature> > &sv = model->sv;
+	std::vector<double> &coef = model->coef;
+	budget = std::max(budget, 0);
+	int removed = 0;
+	double total = 0;
+
+	if (model->kernelType != KERNEL_RBF)
+	{
+		if (error != NULL)
+		{
+			*error = 0;
+		}
+		return 0;
+	}
+
+	std::vector<double> norm(sv.size());
+	for (size_t k = 0; k < sv.size(); k++)
+	{
+		norm[k] = dot(&sv[k][0], &sv[k][0]);
+	}
+
+	while ((int) sv.size() > budget)
+	{
+		size_t m = 0;
+		for (size_t k = 1; k < coef.size(); k++)
+		{
+			if (fabs(coef[k]) < fabs(coef[m]))
+			{
+				m = k;
+			}
+		}
+
+		// the partner of the same sign whose merge loses the least, ranked on the table
+		static const MergeTable table;
+		double a = fabs(coef[m]);
+		long best = -1;
+		double bestLoss = a * a;	// dropping m
+		double bestD = 0;
+		for (size_t n = 0; n < sv.size(); n++)
+		{
+			if (n == m || (coef[n] > 0) != (coef[m] > 0))
+			{
+				continue;
+			}
+			double c = fabs(coef[n]);
+			double d = std::max(norm[m] + norm[n] - 2 * dot(&sv[m][0], &sv[n][0]), 0.0);
+			double k = exp(-model->gamma * d);
+			double alpha = (a + c) * table(a / (a + c), k);
+			double loss = a * a + c * c + 2 * a * c * k - alpha * alpha;
+			if (loss < bestLoss)
+			{
+				best = n;
+				bestLoss = loss;
+				bestD = d;
+			}
+		}
+
+		size_t drop = m;
+		if (best >= 0)
+		{
+			// z replaces n, m goes; h is searched for the chosen partner only
+			double c = fabs(coef[best]), h;
+			double alpha = merge(a, c, model->gamma, bestD, &h);
+			bestLoss = a * a + c * c + 2 * a * c * exp(-model->gamma * bestD) - alpha * alpha;
+			sv[best] = combine(&sv[m][0], &sv[best][0], h);
+			coef[best] = (coef[m] > 0) ? alpha : -alpha;
+			norm[best] = dot(&sv[best][0], &sv[best][0]);
+		}
+		total += std::max(bestLoss, 0.0);
+
+		sv[drop].swap(sv.back());
+		coef[drop] = coef.back();
+		norm[drop] = norm.back();
+		sv.pop_back();
+		coef.pop_back();
+		norm.pop_back();
+		++removed;
+	}
+
+	if (error != NULL)
+	{
+		*error = total;
+	}
+	return removed;
+}
+
+}
+;
+// namespace
@@ -0,0 +1,151 @@
+#include <mysvm.h>
+#include <reorder.h>
+#include <random.h>
+
+namespace MySVM
+{
+
+#define CLUSTER_ROUNDS 5				// Lloyd iterations
+#define CLUSTER_ELEMENTS (1L << 24)		// centers are dense; at most this many doubles in all
+
+/** \brief Assigns each row to its nearest center, |x - c|^2 = |x|^2 + |c|^2 - 2 <x, c> */
+static void assign(const Problem &prob, const std::vector<double> &norm, const std::vector<double> &centers,
+		int k, std::vector<int> *cluster)
+{
+	int M = prob.features;
+	std::vector<double> centerNorm(k, 0);
+	for (int c = 0; c < k; c++)
+	{
+		for (int j = 0; j < M; j++)
+		{
+			centerNorm[c] += centers[(size_t) c * M + j] * centers[(size_t) c * M + j];
+		}
+	}
+	for (int i = 0; i < prob.length; i++)
+	{
+		double best = HUGE_VAL;
+		for (int c = 0; c < k; c++)
+		{
+			const double *center = &centers[(size_t) c * M];
+			double d = norm[i] + centerNorm[c];
+			for (const Feature *f = prob.x[i]; f->index != -1; ++f)
+			{
+				d -= 2 * f->value * center[f->index - 1];
+			}
+			if (d < best)
+			{
+				best = d;
+				(*cluster)[i] = c;
+			}
+		}
+	}
+}
+
+void order_rows(const Problem &prob, RowOrder order, uint64_t seed, std::vector<int> *rows)
+{
+	int N = prob.length;
+	rows->resize(N);
+	for (int i = 0; i < N; i++)
+	{
+		(*rows)[i] = i;
+	}
+	if (order == ORDER_NONE || N == 0)
+	{
+		return;
+	}
+
+	std::vector<double> norm(N);
+	for (int i = 0; i < N; i++)
+	{
+		norm[i] = dot(prob.x[i], prob.x[i]);
+	}
+
+	// sqrt(N / 16) clusters, at most 64, fewer if their dense centers would not fit
+	std::vector<int> cluster(N, 0);
+	if (order == ORDER_CLUSTER && prob.features > 0)
+	{
+		int M = prob.features;
+		int k = (int) std::min(std::min((long) sqrt(N / 16.0) + 1, 64L), std::max(CLUSTER_ELEMENTS / M, 1L));
+		k = std::min(k, N);
+		std::vector<double> centers((size_t) k * M, 0);
+		std::vector<int> count(k);
+
+		// seeded centers: k distinct rows, then a few rounds of Lloyd
+		std::vector<int> pick(*rows);
+		Random rng(seed);
+		rng.shuffle(&pick[0], N);
+		for (int c = 0; c < k; c++)
+		{
+			for (const Feature *f = prob.x[pick[c]]; f->index != -1; ++f)
+			{
+				centers[(size_t) c * M + f->index - 1] = f->value;
+			}
+		}
+		for (int round = 0; round < CLUSTER_ROUNDS; round++)
+		{
+			assign(prob, norm, centers, k, &cluster);
+			std::fill(centers.begin(), centers.end(), 0);
+			std::fill(count.begin(), count.end(), 0);
+			for (int i = 0; i < N; i++)
+			{
+				++count[cluster[i]];
+				for (const Feature *f = prob.x[i]; f->index != -1; ++f)
+				{
+					centers[(size_t) cluster[i] * M + f->index - 1] += f->value;
+				}
+			}
+			for (int c = 0; c < k; c++)
+			{
+				for (int j = 0; count[c] > 0 && j < M; j++)
+				{
+					centers[(size_t) c * M + j] /= count[c];
+				}
+			}
+		}
+		assign(prob, norm, centers, k, &cluster);
+
+		// clusters ordered by their share of positive rows, so that mixed ones sit together
+		std::vector<double> positive(k, 0);
+		std::fill(count.begin(), count.end(), 0);
+		for (int i = 0; i < N; i++)
+		{
+			++count[cluster[i]];
+			positive[cluster[i]] += prob.y[i] > 0;
+		}
+		std::vector<int> rank(k);
+		for (int c = 0; c < k; c++)
+		{
+			rank[c] = c;
+		}
+		std::sort(rank.begin(), rank.end(), [&](int a, int b)
+		{
+			return positive[a] * std::max(count[b], 1) < positive[b] * std::max(count[a], 1);
+		});
+		std::vector<int> position(k);
+		for (int c = 0; c < k; c++)
+		{
+			position[rank[c]] = c;
+		}
+		for (int i = 0; i < N; i++)
+		{
+			cluster[i] = position[cluster[i]];
+		}
+	}
+
+	std::stable_sort(rows->begin(), rows->end(), [&](int a, int b)
+	{
+		if (cluster[a] != cluster[b])
+		{
+			return cluster[a] < cluster[b];
+		}
+		if (prob.y[a] != prob.y[b])
+		{
+			return prob.y[a] < prob.y[b];
+		}
+		return norm[a] < norm[b];
+	});
+}
+
+}
+;
+// namespace
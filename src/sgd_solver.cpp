@@ -0,0 +1,169 @@
+#include <mysvm.h>
+#include <sgd_solver.h>
+#include <thread_pool.h>
+#include <atomic>
+
+namespace MySVM
+{
+
+/** \brief Harmonic number H_n = sum_{k=1}^n 1/k; asymptotic expansion for large n */
+static double harmonic(long n)
+{
+	if (n < 64)
+	{
+		double h = 0;
+		for (long k = 1; k <= n; k++)
+		{
+			h += 1.0 / k;
+		}
+		return h;
+	}
+	double x = (double) n;
+	double x2 = 1 / (x * x);
+	return log(x) + 0.57721566490153286 + 1 / (2 * x) - x2 / 12 + x2 * x2 / 120;
+}
+
+/**	\brief a += delta without a lock; the relaxed order is enough, only the sum matters
+ * 	\param shared whether other threads add to a as well; a lone thread can skip the compare-and-swap
+ */
+static inline void add(std::atomic<double> &a, double delta, bool shared)
+{
+	double old = a.load(std::memory_order_relaxed);
+	if (!shared)
+	{
+		a.store(old + delta, std::memory_order_relaxed);
+		return;
+	}
+	while (!a.compare_exchange_weak(old, old + delta, std::memory_order_relaxed))
+	{
+	}
+}
+
+SGDSolver::SGDSolver(const Problem &prob) :
+	w(prob.features, 0), b(0), seed(1), prob_(prob)
+{
+}
+
+long SGDSolver::train(double lambda, int epochs, int batch, int threads)
+{
+	int length = prob_.length;
+	int features = prob_.features;
+	batch = std::max(1, std::min(batch, length));
+	long batches = (length + batch - 1) / batch;
+	long total = batches * std::max(epochs, 0);
+	if (total == 0)
+	{
+		// no step, no iterate to average: w and b stay at 0
+		return 0;
+	}
+	// average the iterates of the last epochs only, the early ones are far off
+	long average = (epochs > 1) ? batches + 1 : 1;
+
+	// index 0 is the constant feature of the threshold, index j the feature j;
+	// the threads share them, so every access is atomic
+	std::vector< std::atomic<double> > v(features + 1);
+	std::vector< std::atomic<double> > acc(features + 1);
+	for (int j = 0; j <= features; j++)
+	{
+		v[j].store(0, std::memory_order_relaxed);
+		acc[j].store(0, std::memory_order_relaxed);
+	}
+	std::vector<int> order(length);
+	for (int i = 0; i < length; i++)
+	{
+		order[i] = i;
+	}
+
+	Random rng(seed);
+	ThreadPool pool(std::max(threads, 1));
+	std::atomic<long> next(1);
+	double scale = 1 / (lambda * batch);
+
+	for (int epoch = 0; epoch < epochs; epoch++)
+	{
+		rng.shuffle(&order[0], length);
+
+		pool.run([&](int thread, int nthreads)
+		{
+			bool shared = nthreads > 1;
+			std::vector<int> violators;
+			for (long k = thread; k < batches; k += nthreads)
+			{
+				// global step number; the iterate w_t the step starts from is v / (t - 1),
+				// and w_1 = 0 has every row inside the margin
+				long t = next++;
+				violators.clear();
+				long end = std::min((long) length, (k + 1) * batch);
+				for (long s = k * batch; s < end; s++)
+				{
+					int i = order[s];
+					double f = v[0].load(std::memory_order_relaxed);
+					for (const Feature *x = prob_.x[i]; x->index != -1; ++x)
+					{
+						f += v[x->index].load(std::memory_order_relaxed) * x->value;
+					}
+					if (prob_.y[i] * f < t - 1 || t == 1)
+					{
+						violators.push_back(i);
+					}
+				}
+
+				// the update reaches the iterates after steps max(t, average) .. total,
+				// w_{s + 1} = v_s / s after step s
+				double weight = harmonic(std::max(t, average) - 1);
+				for (size_t a = 0; a < violators.size(); a++)
+				{
+					int i = violators[a];
+					double delta = prob_.y[i] * scale;
+					add(v[0], delta, shared);
+					add(acc[0], -delta * weight, shared);
+					for (const Feature *x = prob_.x[i]; x->index != -1; ++x)
+					{
+						add(v[x->index], delta * x->value, shared);
+						add(acc[x->index], -delta * x->value * weight, shared);
+					}
+				}
+			}
+		});
+	}
+
+	// average of v_s / s over s = average .. total
+	double last = harmonic(total);
+	double count = total - average + 1;
+	for (int j = 0; j < features; j++)
+	{
+		w[j] = (v[j + 1] * last + acc[j + 1]) / count;
+	}
+	b = -(v[0] * last + acc[0]) / count;
+	return total;
+}
+
+double SGDSolver::objective(double cost) const
+{
+	double norm = b * b;
+	for (size_t j = 0; j < w.size(); j++)
+	{
+		norm += w[j] * w[j];
+	}
+	double loss = 0;
+	for (int i = 0; i < prob_.length; i++)
+	{
+		double margin = prob_.y[i] * (dot(prob_.x[i], &w[0]) - b);
+		loss += std::max(0.0, 1 - margin);
+	}
+	return norm / 2 + cost * loss;
+}
+
+double SGDSolver::accuracy() const
+{
+	int correct = 0;
+	for (int i = 0; i < prob_.length; i++)
+	{
+		correct += prob_.y[i] * (dot(prob_.x[i], &w[0]) - b) > 0;
+	}
+	return prob_.length ? (double) correct / prob_.length : 0;
+}
+
+}
+;
+// namespace
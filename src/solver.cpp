@@ -1,5 +1,7 @@
 #include <mysvm.h>
 #include <solver.h>
+#include <thread_pool.h>
+#include <checkpoint.h>
 
 #define getMax(a,b) a>b?a:b
 #define getMin(a,b) a<b?a:b
@@ -7,14 +9,211 @@
 namespace MySVM
 {
 
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
 // Solver class constructor
-Solver::Solver()
+Solver::Solver() :
+	y(NULL), x(NULL), alpha(NULL), w(NULL), b(0), error(NULL), length(0),
+	features(0), randi(NULL), kernelType(KERNEL_LINEAR), gamma(0),
+	updates(0), lazyErrors(false), seed(1), tolerance(EPS), dual(0), maxGap(0), maxSeconds(0), maxUpdates(0),
+	stopReason("converged"), progressInterval(1), checkpointer(NULL), order(NULL), pages(PAGES_MALLOC), quantized(NULL),
+	sweeps(0), sweepTries(0),
+	sweepSeconds(0), stamp(NULL), historyB(0), started_(0), reported_(0)
+{
+	// x, y, length, features and the kernel are set by the caller, the rest by init()
+}
+
+Solver::~Solver()
+{
+	// the arena and the kernel cache free themselves
+}
+
+void Solver::init(unsigned long cacheBytes, ThreadPool *pool)
+{
+	//TODO: initialize error|alphas|y differently?
+	size_t rows = (size_t) length;
+	arena_.reset(2 * Arena::align(rows * sizeof(double)) + Arena::align(rows * sizeof(int))
+			+ Arena::align(rows * sizeof(size_t)) + Arena::align((size_t) features * sizeof(double)),
+			pool == NULL, pages);
+	alpha = arena_.allocate<double>(rows);
+	error = arena_.allocate<double>(rows);
+	randi = arena_.allocate<int>(rows);
+	stamp = arena_.allocate<size_t>(rows);
+	w = arena_.allocate<double>((size_t) features);
+
+	b = 0;
+	cache.reset(cacheBytes > 0 ? new KernelCache(length, cacheBytes, pages) : NULL);
+	updates = 0;
+	sweeps = 0;
+	sweepTries = 0;
+	sweepSeconds = 0;
+	rng.seed(seed);
+	history.clear();
+	historyB = b;
+	loop.passes = 0;
+	loop.index = 0;
+	loop.numChanged = 0;
+	loop.examineAll = true;
+	dual = 0;
+	stopReason = "converged";
+
+	ThreadPool::Job job = [&](int thread, int nthreads)
+	{
+		long begin, end;
+		ThreadPool::range(length, thread, nthreads, &begin, &end);
+		for (long i = begin; i < end; i++)
+		{
+			error[i] = -y[i]; // init error to opposite signed y (other side of the separating margin)
+			alpha[i] = 0;
+			randi[i] = i;
+			stamp[i] = 0;
+		}
+	};
+	if (pool != NULL)
+	{
+		pool->run(job);
+	}
+	else
+	{
+		job(0, 1);
+	}
+
+	for (int j = 0; j < features; j++)
+	{
+		w[j] = 0;
+	}
+}
+
+void Solver::recompute(ThreadPool *pool)
+{
+	std::vector<int> sv;
+	for (int i = 0; i < length; i++)
+	{
+		if (alpha[i] > 0)
+		{
+			sv.push_back(i);
+		}
+	}
+
+	for (int j = 0; j < features; j++)
+	{
+		w[j] = 0;
+	}
+	if (kernelType == KERNEL_LINEAR)
+	{
+		for (size_t k = 0; k < sv.size(); k++)
+		{
+			for (int j = 0; j < features; j++)
+			{
+				w[j] += y[sv[k]] * alpha[sv[k]] * x[sv[k]][j];
+			}
+		}
+	}
+
+	// E_i = sum_j alpha_j y_j K(i, j) - b - y_i, only support vectors contribute
+	ThreadPool::Job job = [&](int thread, int nthreads)
+	{
+		long begin, end;
+		ThreadPool::range(length, thread, nthreads, &begin, &end);
+		for (long i = begin; i < end; i++)
+		{
+			if (kernelType == KERNEL_LINEAR)
+			{
+				error[i] = linearError(i);
+				continue;
+			}
+			double f = -b;
+			for (size_t k = 0; k < sv.size(); k++)
+			{
+				f += alpha[sv[k]] * y[sv[k]] * kernel(x, i, sv[k]);
+			}
+			error[i] = f - y[i];
+		}
+	};
+	if (pool != NULL)
+	{
+		pool->run(job);
+	}
+	else
+	{
+		job(0, 1);
+	}
+
+	history.clear();
+	std::fill(stamp, stamp + (size_t) length, 0);
+	historyB = b;
+	dual = objective();
+}
+
+double Solver::currentError(int index)
 {
-	// variables initialized in main();
+	if (!lazyErrors || stamp[index] == history.size())
+	{
+		return error[index];
+	}
+
+	if (kernelType == KERNEL_LINEAR)
+	{
+		error[index] = linearError(index);
+	}
+	else
+	{
+		// K(r, index) = K(index, r), so columns still in the cache save the evaluations
+		double since = (stamp[index] == 0) ? historyB : history[stamp[index] - 1].b;
+		double E = error[index] - b + since;
+		for (size_t k = stamp[index]; k < history.size(); k++)
+		{
+			const double *col_i = cache->peek(history[k].index_i);
+			const double *col_j = cache->peek(history[k].index_j);
+			E += history[k].delta_i * (col_i ? col_i[index] : kernel(x, index, history[k].index_i))
+					+ history[k].delta_j * (col_j ? col_j[index] : kernel(x, index, history[k].index_j));
+		}
+		error[index] = E;
+	}
+	stamp[index] = history.size();
+	return error[index];
+}
+
+void Solver::syncErrors()
+{
+	for (int i = 0; i < length; i++)
+	{
+		currentError(i);
+	}
+	history.clear();
+	std::fill(stamp, stamp + (size_t) length, 0);
+	historyB = b;
 }
 
-double Solver::kernel(double* x[], int index_i, int index_j)
+double Solver::kernel(double* x[], int index_i, int index_j) const
 {
+	if (quantized != NULL)
+	{
+		// |x_i - x_j|^2 = |x_i|^2 + |x_j|^2 - 2 <x_i, x_j>, clamped against rounding
+		double product = quantized->dot(index_i, index_j);
+		if (kernelType == KERNEL_RBF)
+		{
+			return exp(-gamma * std::max(quantized->norm(index_i) + quantized->norm(index_j) - 2 * product, 0.0));
+		}
+		return product;
+	}
+
+	if (kernelType == KERNEL_RBF)
+	{
+		double distance = 0;
+		for (int i = 0; i < features; i++)
+		{
+			double d = x[index_i][i] - x[index_j][i];
+			distance += d * d;
+		}
+		return exp(-gamma * distance);
+	}
+
 	double dotProduct = 0;
 
 	for (int i = 0; i < features; i++)
@@ -27,18 +226,39 @@ double Solver::kernel(double* x[], int index_i, int index_j)
 	return dotProduct;
 }
 
+double Solver::linearError(int index) const
+{
+	double f = 0;
+	for (int j = 0; j < features; j++)
+	{
+		f += w[j] * x[index][j];
+	}
+	return f - b - y[index];
+}
+
+double *Solver::kernelRow(int index)
+{
+	bool cached;
+	double *row = cache->column(index, &cached);
+	for (int i = 0; !cached && i < length; i++)
+	{
+		row[i] = kernel(x, index, i);
+	}
+	return row;
+}
+
 int Solver::examine(int index_j)
 {
 	double y2 = y[index_j];
 	double alph2 = alpha[index_j];
-	double E2 = error[index_j];
+	double E2 = currentError(index_j);
 	double r2 = E2 * y2;
 
 	int index_i = 0;
 	std::vector<int>::iterator iter;
 	std::vector<int> nonBoundAlphaIdx;
 
-	if ((r2 < -EPS && alph2 < C) || (r2 > EPS && alph2 > 0))
+	if ((r2 < -tolerance && alph2 < C) || (r2 > tolerance && alph2 > 0))
 	{
 		//find number and indices of non-zero and non-C alphas
 		nonBoundAlphaIdx.clear(); // reset index vector
@@ -49,12 +269,9 @@ int Solver::examine(int index_j)
 				std::clog << "DEBUG:: alpha returned was < 0" << std::endl;
 			}
 
-			if (alpha[index_i] > EPS && alpha[index_i] < (C - EPS)
-					&& alpha[index_i] > (C + EPS))
+			if (nonBound(index_i))
 			{
 				// push non-bound alpha index into vector cache
-				//TODO: remove
-				printf("-------- found non-zero/bound alpha -------------\n");
 				nonBoundAlphaIdx.push_back(index_i);
 			}
 		}
@@ -72,8 +289,6 @@ int Solver::examine(int index_j)
 			{
 				if (fabs(error[*iter] - E2) > errorDiff)
 				{
-					//TODO: remove
-					printf("looking at error index %f \n",error[*iter]);
 					index_i = *iter;
 					errorDiff = fabs(error[*iter] - E2);
 				}
@@ -88,14 +303,12 @@ int Solver::examine(int index_j)
 		}
 
 		//loop over all non-zero and non-c alpha, starting at a random point
-		random_shuffle(nonBoundAlphaIdx.begin(), nonBoundAlphaIdx.end());
-		for (iter = nonBoundAlphaIdx.begin(); iter != nonBoundAlphaIdx.end(); ++iter)
+		// (a rotation rather than a shuffle: these loops usually stop early)
+		size_t count = nonBoundAlphaIdx.size();
+		size_t first = count > 0 ? rng.below(count) : 0;
+		for (size_t k = 0; k < count; k++)
 		{
-			index_i = *iter;
-
-			//TODO: remove
-			printf("-------- random nonbound -------------");
-			printf("picked index %d\n", *iter);
+			index_i = nonBoundAlphaIdx[(first + k) % count];
 
 			result = update(index_i, index_j);
 			if (result == 1)
@@ -105,26 +318,38 @@ int Solver::examine(int index_j)
 		}
 
 		// else loop over all possible i1, starting at random point
-		randperm(randi, length);
-		for (int i = 0; i < length; i++)
+		struct timespec start, stop;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		++sweeps;
+		int from = rng.below(length);
+		for (int i = 0; i < length && result == 0; i++)
 		{
-			index_i = randi[i];
+			index_i = (from + i) % (int) length;
+			++sweepTries;
 			result = update(index_i, index_j);
-			if (result == 1)
-			{
-				return 1;
-			}
+		}
+		clock_gettime(CLOCK_MONOTONIC, &stop);
+		sweepSeconds += (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) * 1e-9;
+		if (result == 1)
+		{
+			return 1;
 		}
 	} // if error > tolerance
 
 	return 0;
 }
 
-int Solver::update(int index_i, int index_j)
+bool Solver::nonBound(int index) const
+{
+	// alphas within EPS of a bound are snapped onto it by step()
+	return alpha[index] > 0 && alpha[index] < C;
+}
+
+bool Solver::step(int index_i, int index_j, double E1, double E2, Step *out) const
 {
 	if (index_i == index_j)
 	{
-		return 0;
+		return false;
 	}
 
 	double y1 = y[index_i];
@@ -136,9 +361,6 @@ int Solver::update(int index_i, int index_j)
 	double alpha1updated = 0;
 	double alpha2updated = 0;
 
-	double E2 = error[index_j];
-	double E1 = error[index_i];
-
 	// compute L and H via equations
 	double H = 0;
 	double L = 0;
@@ -155,7 +377,7 @@ int Solver::update(int index_i, int index_j)
 
 	if (L == H)
 	{
-		return 0;
+		return false;
 	}
 
 	double k11 = kernel(x, index_i, index_i); //<x1,x1>;
@@ -180,28 +402,17 @@ int Solver::update(int index_i, int index_j)
 	else
 	{
 		//NOTE: this is a rare case, but SVM should work regardless
-		std::clog << "DEBUG:: eta was negative" << std::endl;
+		// objective function at a2 = L and a2 = H, from the errors alone (Platt eq. 12.21)
+		double f1 = y1 * (E1 + b) - alpha1old * k11 - s * alpha2old * k12;
+		double f2 = y2 * (E2 + b) - s * alpha1old * k12 - alpha2old * k22;
 
-		// calculate these objectives
-		double aa2 = L;
-		double aa1 = alpha1old + s * (alpha2old - aa2);
-		double Lobj = aa1 + aa2; // + (y2 * L * x[]) - b: objective function at a2 = L;
-		for (int elementIndex = 0; elementIndex < length; elementIndex++)
-		{
-			Lobj += ((-y1 * aa1 / 2) * y[elementIndex] * kernel(x,
-					elementIndex, index_i)) + ((-y2 * aa2 / 2)
-					* y[elementIndex] * kernel(x, elementIndex, index_j));
-		}
+		double L1 = alpha1old + s * (alpha2old - L);
+		double Lobj = L1 * f1 + L * f2 + L1 * L1 * k11 / 2 + L * L * k22 / 2
+				+ s * L * L1 * k12;
 
-		aa2 = H;
-		aa1 = alpha1old + s * (alpha2old - aa2);
-		double Hobj = aa1 + aa2; // + (y2 * H * x[]) - b: objective function at a2 = H;
-		for (int elementIndex = 0; elementIndex < length; elementIndex++)
-		{
-			Hobj += ((-y1 * aa1 / 2) * y[elementIndex] * kernel(x,
-					elementIndex, index_i)) + ((-y2 * aa2 / 2)
-					* y[elementIndex] * kernel(x, elementIndex, index_j));
-		}
+		double H1 = alpha1old + s * (alpha2old - H);
+		double Hobj = H1 * f1 + H * f2 + H1 * H1 * k11 / 2 + H * H * k22 / 2
+				+ s * H * H1 * k12;
 
 		if (EPS < (Hobj - Lobj))
 		{
@@ -229,11 +440,9 @@ int Solver::update(int index_i, int index_j)
 
 	double diff = fabs(alpha2updated - alpha2old);
 	double thresh = EPS * (alpha2updated + alpha2old + EPS);
-	//TODO: remove
-	//printf("a1new:%f, a1old:%f | diff:%f ? thresh:%f ",alpha2updated,alpha2old,diff,thresh);
 	if (diff < thresh)
 	{
-		return 0;
+		return false;
 	}
 
 	// update alpha_1
@@ -247,11 +456,8 @@ int Solver::update(int index_i, int index_j)
 		alpha1updated = C;
 	}
 
-	//TODO: consider keeping track of alphas at bounds here
-
 	// update bias (threshold) to reflect change in alphas
 	// 2.3 Computing the Threshold
-	double bold = b;
 	double deltaalpha1 = alpha1updated - alpha1old;
 	double deltaalpha2 = alpha2updated - alpha2old;
 
@@ -260,79 +466,619 @@ int Solver::update(int index_i, int index_j)
 
 	if (!((alpha1updated == H) || (alpha1updated == L)))
 	{
-		b = b1;
+		out->b = b1;
 	}
 	else if (!((alpha2updated == H) || (alpha2updated == L)))
 	{
-		b = b2;
+		out->b = b2;
 	}
 	else
 	{
-		b = (b1 + b2) / 2;
+		out->b = (b1 + b2) / 2;
 	}
 
+	out->index_i = index_i;
+	out->index_j = index_j;
+	out->alpha_i = alpha1updated;
+	out->alpha_j = alpha2updated;
+	out->delta_i = y1 * deltaalpha1;
+	out->delta_j = y2 * deltaalpha2;
+
+	// W = sum(alpha) - 1/2 sum_kl alpha_k alpha_l y_k y_l K(k, l), and
+	// sum_l alpha_l y_l K(k, l) = E_k + y_k + b for the pair before the step
+	double f1 = E1 + y1 + b;
+	double f2 = E2 + y2 + b;
+	out->gain = deltaalpha1 + deltaalpha2 - out->delta_i * f1 - out->delta_j * f2
+			- (out->delta_i * out->delta_i * k11 + 2 * out->delta_i * out->delta_j * k12
+					+ out->delta_j * out->delta_j * k22) / 2;
+	return true;
+}
+
+void Solver::commit(const Step &step)
+{
 	// update weight vector
 	// 2.4 An Optimization for Linear SVMs
 	//TODO: look at this closer
-	for (int findex = 0; findex < features; findex++)
+	for (int findex = 0; kernelType == KERNEL_LINEAR && findex < features; findex++)
 	{
-		w[findex] = w[findex] + y1 * deltaalpha1 * x[index_i][findex] + y2
-				* deltaalpha2 * x[index_j][findex];
+		w[findex] = w[findex] + step.delta_i * x[step.index_i][findex]
+				+ step.delta_j * x[step.index_j][findex];
 	}
 
+	// update the alpha array with the new values
+	alpha[step.index_i] = step.alpha_i;
+	alpha[step.index_j] = step.alpha_j;
+	b = step.b;
+	dual += step.gain;
+	++updates;
+}
+
+int Solver::update(int index_i, int index_j)
+{
+	Step s;
+	if (!step(index_i, index_j, currentError(index_i), currentError(index_j), &s))
+	{
+		return 0;
+	}
+
+	if (lazyErrors)
+	{
+		// Platt only needs exact errors for the non-bound alphas (and the pair,
+		// whose alphas just changed); the rest catch up when examined. Other
+		// kernels still fetch the pair's columns, which the catching up reuses.
+		if (kernelType != KERNEL_LINEAR)
+		{
+			kernelRow(index_i);
+			kernelRow(index_j);
+		}
+		commit(s);
+		history.push_back(s);
+		for (int i = 0; i < length; i++)
+		{
+			if (nonBound(i) || i == index_i || i == index_j)
+			{
+				currentError(i);
+			}
+		}
+		return 1;
+	}
+
+	// for the linear kernel the errors can come straight from w, at the cost of
+	// one pass over the data, about what computing one kernel row costs; that
+	// beats the kernel rows once most of them miss the cache. Every 8th update
+	// still goes through the cache, so that its hit rate stays current.
+	if (kernelType == KERNEL_LINEAR && cache->misses > cache->hits && (updates + 1) % 8 != 0)
+	{
+		commit(s);
+		for (int i = 0; i < length; i++)
+		{
+			error[i] = linearError(i);
+		}
+		return 1;
+	}
+
+	// the cache holds at least two rows, so fetching row_j never evicts row_i
+	double *row_i = kernelRow(index_i);
+	double *row_j = kernelRow(index_j);
+
+	double bold = b;
+	commit(s);
+
 	// update error cache using new lagrange mults
 	for (int i = 0; i < length; i++)
 	{
-		error[i] += y1 * deltaalpha1 * kernel(x, i, index_i) + y2 * deltaalpha2
-				* kernel(x, i, index_j) - b + bold;
+		error[i] += s.delta_i * row_i[i] + s.delta_j * row_j[i] - b + bold;
 	}
-	//TODO: maybe unnecessary: set the errors to exactly 0 for the optimized alphas
-//	error[index_i] = 0.0;
-//	error[index_j] = 0.0;
-
-	// update the alpha array with the new values
-	alpha[index_i] = alpha1updated;
-	alpha[index_j] = alpha2updated;
 
 	return 1;
 }
 
-void Solver::randperm(int* A, int n)
+int Solver::train()
 {
-	int i;
-	int x;
+	// a restored checkpoint resumes inside the pass it was taken in
+	bool resumed = loop.passes > 0;
+	bool stop = false;
+	bool watching = progress || maxGap > 0 || maxSeconds > 0 || maxUpdates > 0;
+	started_ = reported_ = now();
+	stopReason = "converged";
 
-	for (i = 0; i < n; i++)
+	while (!stop && (resumed || (loop.numChanged > 0) || loop.examineAll))
 	{
-		A[i] = i;
+		if (!resumed)
+		{
+			loop.numChanged = 0;
+			loop.index = 0;
+			++loop.passes;
+		}
+		resumed = false;
+
+		// OUTER LOOP (first lagrange multiplier)
+		// first, loop over entire training set, else iterate over multipliers that are not at the bounds
+		while (loop.index < length)
+		{
+			if (loop.examineAll || nonBound(loop.index))
+			{
+				loop.numChanged += examine(loop.index);
+			}
+			++loop.index;
+
+			// the clock is read every 64 rows
+			if ((loop.index & 63) == 0)
+			{
+				if (checkpointer != NULL && checkpointer->due())
+				{
+					checkpointer->save(*this);
+				}
+				if (watching && watch(false))
+				{
+					stop = true;
+					break;
+				}
+			}
+		}
+		if (stop)
+		{
+			break;
+		}
+
+		// if subset was unchanged, loop over entire set again
+		if (loop.examineAll)
+		{
+			// every row has been examined, so syncing costs little and keeps
+			// the step history short
+			syncErrors();
+			loop.examineAll = false;
+		}
+		else if (loop.numChanged == 0)
+		{
+			loop.examineAll = true;
+		}
+		stop = watching && (loop.numChanged > 0 || loop.examineAll) && watch(true);
 	}
 
-	for (i = 0; i < n; i++)
+	syncErrors();
+	return loop.passes;
+}
+
+bool Solver::propose(int index_j, const std::vector<int> &nonBoundIdx, int slot, int slots,
+		Random &rng, Step *out) const
+{
+	double y2 = y[index_j];
+	double alph2 = alpha[index_j];
+	double E2 = error[index_j];
+	double r2 = E2 * y2;
+
+	if (!((r2 < -tolerance && alph2 < C) || (r2 > tolerance && alph2 > 0)))
 	{
-		int temp;
+		return false;
+	}
 
-		/* swap A[i] with a random A[x] */
-		x = lrand48() % n;
-		temp = A[i];
-		A[i] = A[x];
-		A[x] = temp;
+	// second choice heuristic: maximize |E1 - E2| over this slot's share of the
+	// non-bound alphas, so that the slots of a batch pick disjoint partners
+	if (nonBoundIdx.size() > 1)
+	{
+		int index_i = 0;
+		double errorDiff = 0;
+		for (size_t k = slot; k < nonBoundIdx.size(); k += slots)
+		{
+			if (fabs(error[nonBoundIdx[k]] - E2) > errorDiff)
+			{
+				index_i = nonBoundIdx[k];
+				errorDiff = fabs(error[index_i] - E2);
+			}
+		}
+		if (step(index_i, index_j, error[index_i], E2, out))
+		{
+			return true;
+		}
+	}
+
+	// loop over the non-bound alphas, then over all of them, starting at a random point
+	if (!nonBoundIdx.empty())
+	{
+		size_t start = rng.below(nonBoundIdx.size());
+		for (size_t k = 0; k < nonBoundIdx.size(); k++)
+		{
+			int index_i = nonBoundIdx[(start + k) % nonBoundIdx.size()];
+			if (step(index_i, index_j, error[index_i], E2, out))
+			{
+				return true;
+			}
+		}
+	}
+
+	int start = rng.below(length);
+	for (int k = 0; k < length; k++)
+	{
+		int index_i = (start + k) % (int) length;
+		if (step(index_i, index_j, error[index_i], E2, out))
+		{
+			return true;
+		}
 	}
+
+	return false;
+}
+
+// kernel column of an accepted pair of a batch in trainParallel(); one that
+// missed the cache is only filled in the merge pass
+struct BatchColumn {
+	int index;
+	double *data;
+	bool cached;
+};
+
+double Solver::columnEntry(const BatchColumn &col, int row) const
+{
+	return col.cached ? col.data[row] : kernel(x, col.index, row);
+}
+
+int Solver::trainParallel(int threads)
+{
+	ThreadPool pool(threads, cpus);
+	// a fixed batch keeps the sequence of commits the same for any thread count
+	const int batch = 16;
+
+	std::vector<int> candidates;
+	std::vector<int> nonBoundIdx;
+	std::vector<Step> proposals(batch);
+	std::vector<char> proposed(batch);
+	std::vector<Step> accepted;
+	std::vector<char> busy(length, 0);
+	std::vector<char> requeued(length, 0);
+	std::vector<BatchColumn> columns;
+	// the columns of a batch stay cached as long as there are no more than this many
+	size_t capacity = cache->capacity();
+
+	int &numChanged = loop.numChanged;
+	int &passes = loop.passes;
+	bool &examineAll = loop.examineAll;
+	// a restored checkpoint repeats the pass it was taken in
+	bool resumed = passes > 0;
+	bool stop = false;
+	bool watching = progress || maxGap > 0 || maxSeconds > 0 || maxUpdates > 0;
+	started_ = reported_ = now();
+	stopReason = "converged";
+
+	while (!stop && (resumed || (numChanged > 0) || examineAll))
+	{
+		numChanged = 0;
+		loop.index = 0;
+		if (!resumed)
+		{
+			++passes;
+			// checkpoints are taken as a pass starts
+			if (checkpointer != NULL && checkpointer->due())
+			{
+				checkpointer->save(*this);
+			}
+		}
+		resumed = false;
+
+		// randomized sweep over the entire set, or over the non-bound multipliers
+		randperm(randi, length);
+		candidates.clear();
+		for (int k = 0; k < length; k++)
+		{
+			requeued[k] = 0;
+			if (examineAll || nonBound(randi[k]))
+			{
+				candidates.push_back(randi[k]);
+			}
+		}
+
+		for (size_t first = 0; first < candidates.size(); first += batch)
+		{
+			// every 4 batches, as the serial loop every 64 rows
+			if (watching && (first / batch) % 4 == 3 && watch(false))
+			{
+				stop = true;
+				break;
+			}
+			int count = getMin((int) (candidates.size() - first), batch);
+
+			nonBoundIdx.clear();
+			for (int i = 0; i < length; i++)
+			{
+				if (nonBound(i))
+				{
+					nonBoundIdx.push_back(i);
+				}
+			}
+			// only split the partners between the slots when each gets a few
+			int slots = (nonBoundIdx.size() >= (size_t) (4 * count)) ? count : 1;
+
+			// 1. propose one pair step per candidate against the current snapshot
+			pool.run([&](int thread, int nthreads)
+			{
+				for (int k = thread; k < count; k += nthreads)
+				{
+					Random rng(seed, ((uint64_t) passes << 32) | (first + k));
+					proposed[k] = propose(candidates[first + k], nonBoundIdx, k % slots, slots,
+							rng, &proposals[k]);
+				}
+			});
+
+			// 2. commit disjoint pairs in order; each step is recomputed with its
+			//    errors corrected for the pairs accepted before it, so the batch is
+			//    equivalent to running the accepted steps one after another. The
+			//    columns of the accepted pairs are taken from the kernel cache, which
+			//    must hold all of them until the merge; missing ones are filled there
+			double bsnap = b;
+			accepted.clear();
+			columns.clear();
+			for (int k = 0; k < count; k++)
+			{
+				if (!proposed[k])
+				{
+					continue;
+				}
+				bool full = kernelType != KERNEL_LINEAR && 2 * (accepted.size() + 1) > capacity;
+				if (full || busy[proposals[k].index_i] || busy[proposals[k].index_j])
+				{
+					// give a candidate that lost a conflict one more turn later in the pass
+					int index_j = candidates[first + k];
+					if (!requeued[index_j])
+					{
+						requeued[index_j] = 1;
+						candidates.push_back(index_j);
+					}
+					continue;
+				}
+
+				int index_i = proposals[k].index_i;
+				int index_j = proposals[k].index_j;
+				double E1, E2;
+				if (kernelType == KERNEL_LINEAR)
+				{
+					// w already has the accepted steps
+					E1 = linearError(index_i);
+					E2 = linearError(index_j);
+				}
+				else
+				{
+					E1 = error[index_i] - b + bsnap;
+					E2 = error[index_j] - b + bsnap;
+					for (size_t a = 0; a < accepted.size(); a++)
+					{
+						E1 += accepted[a].delta_i * columnEntry(columns[2 * a], index_i)
+								+ accepted[a].delta_j * columnEntry(columns[2 * a + 1], index_i);
+						E2 += accepted[a].delta_i * columnEntry(columns[2 * a], index_j)
+								+ accepted[a].delta_j * columnEntry(columns[2 * a + 1], index_j);
+					}
+				}
+
+				Step s;
+				if (step(index_i, index_j, E1, E2, &s))
+				{
+					commit(s);
+					accepted.push_back(s);
+					busy[index_i] = busy[index_j] = 1;
+					if (kernelType != KERNEL_LINEAR)
+					{
+						columns.push_back(BatchColumn());
+						columns.back().index = index_i;
+						columns.back().data = cache->column(index_i, &columns.back().cached);
+						columns.push_back(BatchColumn());
+						columns.back().index = index_j;
+						columns.back().data = cache->column(index_j, &columns.back().cached);
+					}
+				}
+			}
+
+			// 3. merge the error cache deltas of all accepted pairs in one pass, each
+			//    thread first filling its rows of the columns that missed the cache
+			//    (for the linear kernel, recompute the errors from w, which already has them all)
+			if (!accepted.empty())
+			{
+				double db = b - bsnap;
+				pool.run([&](int thread, int nthreads)
+				{
+					long begin, end;
+					ThreadPool::range(length, thread, nthreads, &begin, &end);
+					for (size_t c = 0; c < columns.size(); c++)
+					{
+						for (long i = begin; !columns[c].cached && i < end; i++)
+						{
+							columns[c].data[i] = kernel(x, columns[c].index, i);
+						}
+					}
+					for (long i = begin; i < end; i++)
+					{
+						if (kernelType == KERNEL_LINEAR)
+						{
+							error[i] = linearError(i);
+							continue;
+						}
+						double delta = -db;
+						for (size_t a = 0; a < accepted.size(); a++)
+						{
+							delta += accepted[a].delta_i * columns[2 * a].data[i]
+									+ accepted[a].delta_j * columns[2 * a + 1].data[i];
+						}
+						error[i] += delta;
+					}
+				});
+
+				for (size_t a = 0; a < accepted.size(); a++)
+				{
+					busy[accepted[a].index_i] = busy[accepted[a].index_j] = 0;
+				}
+				numChanged += accepted.size();
+			}
+		}
+		if (stop)
+		{
+			break;
+		}
+
+		// if subset was unchanged, loop over entire set again
+		if (examineAll)
+		{
+			examineAll = false;
+		}
+		else if (numChanged == 0)
+		{
+			examineAll = true;
+		}
+		stop = watching && (numChanged > 0 || examineAll) && watch(true);
+	}
+
+	return passes;
+}
+
+void measure_errors(int length, const double *y, const double *alpha, const double *error, double b,
+		double dual, Progress *out)
+{
+	// with F_k = E_k + b = f(x_k) - y_k, the KKT conditions ask for a b with
+	// F_k <= b on up = {y = 1, alpha > 0} u {y = -1, alpha < C} and
+	// F_k >= b on low = {y = 1, alpha < C} u {y = -1, alpha > 0}
+	double maxUp = -HUGE_VAL, minLow = HUGE_VAL;
+	double wsq = 0, hinge = 0;
+	int sv = 0, bound = 0;
+	for (int i = 0; i < length; i++)
+	{
+		double F = error[i] + b;
+		bool positive = y[i] > 0;
+		if (alpha[i] > 0)
+		{
+			wsq += alpha[i] * y[i] * (F + y[i]);
+			++sv;
+			bound += alpha[i] >= C;
+		}
+		if ((positive && alpha[i] > 0) || (!positive && alpha[i] < C))
+		{
+			maxUp = std::max(maxUp, F);
+		}
+		if ((positive && alpha[i] < C) || (!positive && alpha[i] > 0))
+		{
+			minLow = std::min(minLow, F);
+		}
+		// slack max(0, 1 - y_k (f(x_k) - b)) = max(0, -y_k E_k)
+		hinge += std::max(0.0, -y[i] * error[i]);
+	}
+
+	out->dual = dual;
+	out->primal = wsq / 2 + C * hinge;
+	out->gap = out->primal - dual;
+	out->violation = (maxUp > -HUGE_VAL && minLow < HUGE_VAL) ? std::max(maxUp - minLow, 0.0) : 0;
+	out->supportVectors = sv;
+	out->boundVectors = bound;
+}
+
+void Solver::measure(Progress *out)
+{
+	if (lazyErrors)
+	{
+		syncErrors();
+	}
+
+	measure_errors(length, y, alpha, error, b, dual, out);
+	out->passes = loop.passes;
+	out->index = loop.index;
+	out->updates = updates;
+	out->seconds = now() - started_;
+}
+
+bool Solver::watch(bool passEnd)
+{
+	if (maxUpdates > 0 && updates >= maxUpdates)
+	{
+		stopReason = "updates";
+		return true;
+	}
+	double t = now();
+	if (maxSeconds > 0 && t - started_ >= maxSeconds)
+	{
+		stopReason = "time";
+		return true;
+	}
+
+	// measuring is one pass over the rows, cheap next to a pass of examine()
+	// calls; a lazy error cache would have to be synced, so it waits for the interval
+	if ((!progress && maxGap <= 0) || ((!passEnd || lazyErrors) && t - reported_ < progressInterval))
+	{
+		return false;
+	}
+	Progress p;
+	measure(&p);
+	reported_ = t;
+	if (progress)
+	{
+		progress(p);
+	}
+	if (maxGap > 0 && p.gap <= maxGap * fabs(p.primal))
+	{
+		stopReason = "gap";
+		return true;
+	}
+	return false;
+}
+
+double Solver::objective() const
+{
+	// sum_j alpha_j y_j K(i, j) = E_i + y_i + b, so the quadratic term comes from the error cache
+	double sum = 0;
+	double quad = 0;
+	for (int i = 0; i < length; i++)
+	{
+		sum += alpha[i];
+		quad += alpha[i] * y[i] * (error[i] + y[i] + b);
+	}
+	return sum - quad / 2;
+}
+
+void Solver::randperm(int* A, int n)
+{
+	for (int i = 0; i < n; i++)
+	{
+		A[i] = i;
+	}
+	rng.shuffle(A, n);
+}
+
+size_t Solver::stateBytes() const
+{
+	return arena_.bytes() + history.capacity() * sizeof(Step);
 }
 
 void Solver::print()
 {
-	std::cout << "w values were: " << std::endl;
-	for (int i = 0; i < features; i++)
+	if (kernelType == KERNEL_LINEAR)
 	{
-		std::cout << i << ": " << w[i] << std::endl;
+		std::cout << "w values were: " << std::endl;
+		for (int i = 0; i < features; i++)
+		{
+			std::cout << i << ": " << w[i] << std::endl;
+		}
 	}
 
 	//w = alpha * y
 	std::cout << "bias was: " << b << std::endl;
 
+	printf("kernel cache: %.1f of %.1f MB in %lu columns (peak %.1f MB), "
+			"%lu hits, %lu misses, %lu evictions\n",
+			cache->bytes() / 1048576.0, cache->max_bytes() / 1048576.0,
+			cache->columns(), cache->peak_bytes() / 1048576.0, cache->hits,
+			cache->misses, cache->evictions);
+
+	printf("solver state: %.1f MB (%.0f bytes per row), %.1f MB of it in one arena\n",
+			stateBytes() / 1048576.0, length > 0 ? stateBytes() / length : 0.0,
+			arena_.bytes() / 1048576.0);
+
+	printf("examine fallback: %lu sweeps over all rows, %lu pairs tried (%.1f per sweep), %.3f s\n",
+			sweeps, sweepTries, sweeps ? (double) sweepTries / sweeps : 0.0, sweepSeconds);
+
+	// rows in input order
+	std::vector<int> rows(length);
 	for (int i = 0; i < length; i++)
 	{
-		printf("y: %d, error: %d, alpha: %d\n",y[i],error[i],alpha[i]);
+		rows[order ? order[i] : i] = i;
+	}
+	for (int k = 0; k < length; k++)
+	{
+		int i = rows[k];
+		printf("y: %f, error: %f, alpha: %f\n",y[i],error[i],alpha[i]);
 	}
 }
 
@@ -0,0 +1,294 @@
+#include "mysvm.h"
+#include "dataset.h"
+#include <unistd.h>
+#include <stdint.h>
+
+#define Malloc(type,n) (type *)malloc((n)*sizeof(type))
+
+/**
+ *	Synthetic dataset generator for scaling studies of the solver, parser and caches.
+ *
+ *	Rows are drawn from two classes whose means sit at +/- sep * mu, with uniform
+ *	noise on every stored feature and values clipped to [-1, 1] (the same range as
+ *	src/test.input). Every run with the same seed and options yields the same file.
+ */
+
+struct GenParams
+{
+	long rows;			// N
+	int features;		// M
+	double density;		// fraction of features stored per row
+	double positive;	// fraction of rows labelled +1
+	double noise;		// probability of flipping a label
+	double separation;	// distance of the class means from the origin
+	long seed;
+};
+
+static void usage()
+{
+	fprintf(stderr,
+			"usage: svm_gen [options] [output_file]\n"
+			"  -n rows        number of rows (default 1000)\n"
+			"  -m features    number of features (default 13)\n"
+			"  -d density     fraction of non-zero features per row (default 1.0)\n"
+			"  -p positive    fraction of +1 labels (default 0.5)\n"
+			"  -e noise       label flip probability (default 0.0)\n"
+			"  -s separation  class mean separation, 0 is pure noise (default 0.5)\n"
+			"  -S seed        random seed (default 1)\n"
+			"  -b             write the binary format (see dataset.h) instead of libsvm text\n");
+	exit(1);
+}
+
+/** \brief Seeds an erand48 state so that every pass over the data replays the same stream */
+static void seed_state(unsigned short state[3], long seed)
+{
+	state[0] = 0x330E;
+	state[1] = (unsigned short) (seed & 0xFFFF);
+	state[2] = (unsigned short) ((seed >> 16) & 0xFFFF);
+}
+
+/** \brief Draws the per-feature class mean direction, in [-1, 1] */
+static void draw_means(const GenParams &p, unsigned short state[3], double *mu)
+{
+	for (int f = 0; f < p.features; f++)
+	{
+		mu[f] = 2 * erand48(state) - 1;
+	}
+}
+
+/** \brief Generates one row into idx/val and returns its number of stored features */
+static int generate_row(const GenParams &p, unsigned short state[3], const double *mu,
+		int *label, int32_t *idx, double *val)
+{
+	int y = (erand48(state) < p.positive) ? 1 : -1;
+	int nnz = 0;
+
+	for (int f = 0; f < p.features; f++)
+	{
+		if (p.density < 1 && erand48(state) >= p.density)
+		{
+			continue;
+		}
+
+		double v = y * p.separation * mu[f] + (2 * erand48(state) - 1);
+		if (v > 1)
+		{
+			v = 1;
+		}
+		else if (v < -1)
+		{
+			v = -1;
+		}
+
+		idx[nnz] = f + 1;
+		val[nnz] = v;
+		++nnz;
+	}
+
+	if (erand48(state) < p.noise)
+	{
+		y = -y;
+	}
+
+	*label = y;
+	return nnz;
+}
+
+/** \brief Writes libsvm text rows to out; stops at the first write error
+ * 	\return 0 on success, 1 if the buffers could not be allocated
+ */
+static int write_text(const GenParams &p, FILE *out)
+{
+	unsigned short state[3];
+	double *mu = Malloc(double, p.features);
+	int32_t *idx = Malloc(int32_t, p.features);
+	double *val = Malloc(double, p.features);
+	int label;
+
+	if (mu == NULL || idx == NULL || val == NULL)
+	{
+		free(mu);
+		free(idx);
+		free(val);
+		return 1;
+	}
+
+	seed_state(state, p.seed);
+	draw_means(p, state, mu);
+
+	for (long i = 0; i < p.rows && !ferror(out); i++)
+	{
+		int nnz = generate_row(p, state, mu, &label, idx, val);
+
+		fprintf(out, "%+d", label);
+		for (int k = 0; k < nnz; k++)
+		{
+			fprintf(out, " %d:%g", idx[k], val[k]);
+		}
+		fputs(" \n", out);
+	}
+
+	free(mu);
+	free(idx);
+	free(val);
+	return 0;
+}
+
+/**
+ *	The binary layout stores each array contiguously, so the rows are generated
+ *	three times from the same seed (labels/offsets, indices, values) instead of
+ *	holding the whole matrix in memory. Like write_text(), it returns 1 if the
+ *	buffers could not be allocated and stops at the first write error.
+ */
+static int write_binary(const GenParams &p, FILE *out)
+{
+	unsigned short state[3];
+	double *mu = Malloc(double, p.features);
+	int32_t *idx = Malloc(int32_t, p.features);
+	double *val = Malloc(double, p.features);
+	double *y = Malloc(double, p.rows);
+	uint64_t *rowptr = Malloc(uint64_t, p.rows + 1);
+	int label;
+
+	if (mu == NULL || idx == NULL || val == NULL || y == NULL || rowptr == NULL)
+	{
+		free(mu);
+		free(idx);
+		free(val);
+		free(y);
+		free(rowptr);
+		return 1;
+	}
+
+	seed_state(state, p.seed);
+	draw_means(p, state, mu);
+	rowptr[0] = 0;
+	for (long i = 0; i < p.rows; i++)
+	{
+		int nnz = generate_row(p, state, mu, &label, idx, val);
+		y[i] = label;
+		rowptr[i + 1] = rowptr[i] + nnz;
+	}
+
+	MySVM::DatasetHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC));
+	header.version = DATASET_VERSION;
+	header.rows = p.rows;
+	header.features = p.features;
+	header.nnz = rowptr[p.rows];
+
+	fwrite(&header, sizeof(header), 1, out);
+	fwrite(y, sizeof(double), p.rows, out);
+	fwrite(rowptr, sizeof(uint64_t), p.rows + 1, out);
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		seed_state(state, p.seed);
+		draw_means(p, state, mu);
+		for (long i = 0; i < p.rows && !ferror(out); i++)
+		{
+			int nnz = generate_row(p, state, mu, &label, idx, val);
+			if (pass == 0)
+			{
+				fwrite(idx, sizeof(int32_t), nnz, out);
+			}
+			else
+			{
+				fwrite(val, sizeof(double), nnz, out);
+			}
+		}
+	}
+
+	free(mu);
+	free(idx);
+	free(val);
+	free(y);
+	free(rowptr);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	GenParams p;
+	p.rows = 1000;
+	p.features = 13;
+	p.density = 1.0;
+	p.positive = 0.5;
+	p.noise = 0.0;
+	p.separation = 0.5;
+	p.seed = 1;
+	bool binary = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:m:d:p:e:s:S:bh")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			p.rows = strtol(optarg, NULL, 10);
+			break;
+		case 'm':
+			p.features = (int) strtol(optarg, NULL, 10);
+			break;
+		case 'd':
+			p.density = strtod(optarg, NULL);
+			break;
+		case 'p':
+			p.positive = strtod(optarg, NULL);
+			break;
+		case 'e':
+			p.noise = strtod(optarg, NULL);
+			break;
+		case 's':
+			p.separation = strtod(optarg, NULL);
+			break;
+		case 'S':
+			p.seed = strtol(optarg, NULL, 10);
+			break;
+		case 'b':
+			binary = true;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if (p.rows <= 0 || p.features <= 0 || p.density <= 0 || p.density > 1
+			|| p.positive < 0 || p.positive > 1 || p.noise < 0 || p.noise > 1)
+	{
+		usage();
+	}
+
+	FILE *out = stdout;
+	if (optind < argc)
+	{
+		out = fopen(argv[optind], binary ? "wb" : "w");
+		if (out == NULL)
+		{
+			fprintf(stderr, "can't open output file %s\n", argv[optind]);
+			return 1;
+		}
+	}
+	else if (binary && isatty(fileno(stdout)))
+	{
+		fprintf(stderr, "refusing to write binary data to a terminal\n");
+		return 1;
+	}
+
+	if ((binary ? write_binary(p, out) : write_text(p, out)) != 0)
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	// a full disk or a closed pipe only shows in the stream's error flag, or on the final flush
+	bool failed = fflush(out) != 0 || ferror(out);
+	if ((out != stdout && fclose(out) != 0) || failed)
+	{
+		fprintf(stderr, "failed to write output\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -1,266 +1,1549 @@
 #include "mysvm.h"
 #include "solver.h"
+#include "linear_solver.h"
+#include "sgd_solver.h"
+#include "cascade.h"
+#include "distributed.h"
+#include "problem.h"
+#include "model.h"
+#include "online.h"
+#include "evaluate.h"
+#include "reduced_set.h"
+#include "feature_map.h"
+#include "checkpoint.h"
+#include "reorder.h"
+#include "numa.h"
+#include "huge_pages.h"
+#include "quantized_rows.h"
+#include "thread_pool.h"
+#include "random.h"
 #include "log.h"
+#include <getopt.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <memory>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
 #define Malloc(type,n) (type *)malloc((n)*sizeof(type))
 
 // NOTICE: dont include name space in main()
 
-static char *line = NULL;
-static int max_line_len;
+/** \brief Settings of all commands, as given on the command line */
+struct Options {
+	int threads;			///< 0 trains serially; predictions use at least one
+	int partitions;			///< cascade partitions, 0 for none
+	int workers;			///< distributed workers, 0 for none
+	const char *address;	///< coordinator address, NULL forks local workers
+	MySVM::KernelType kernelType;
+	double gamma;			///< 0 picks 1 / features
+	const char *engine;		///< smo, dcd, sgd or NULL to choose by problem
+	const char *output;		///< model, prediction or dataset file
+	bool lazy;
+	uint64_t seed;
+	long cacheMB;			///< SMO kernel cache budget
+	double tolerance;		///< KKT tolerance of SMO and dual coordinate descent
+	int maxPasses;			///< limit on the passes of dual coordinate descent
+	int precision;			///< significant digits of the reals written
+	int batch;				///< 0 for the engine's default
+	double lambda;			///< 0 for the engine's default
+	int epochs;
+	int folds;
+	int repeats;
+	bool binary;			///< convert writes the binary format of dataset.h
+	bool online;
+	std::vector<int> budgets;	///< support vectors kept, by online training or reduced-set merging
+	MySVM::MapType map;			///< explicit RBF feature map trained linearly, MAP_NONE for none
+	std::vector<int> dims;		///< dimensions of the map; cv compares each
+	const char *checkpoint;		///< SMO checkpoint file, NULL for none
+	double interval;			///< seconds between checkpoints
+	const char *resume;			///< checkpoint to continue from, NULL to start afresh
+	const char *progress;		///< file for SMO progress events, "-" for stderr, NULL for none
+	double progressInterval;	///< seconds between progress events within a pass
+	double maxGap;				///< relative duality gap that ends SMO training, 0 for none
+	double maxSeconds;
+	unsigned long maxUpdates;
+	MySVM::RowOrder order;		///< order of the rows smo trains on
+	MySVM::Binding binding;		///< pinning of the parallel smo threads and placement of their rows
+	MySVM::PageMode pages;		///< backing of the smo rows, state and kernel cache
+	bool quantize;				///< smo takes its rbf kernel from int8 rows
+	MySVM::OnlineOptions stream;
 
-/** \brief Reads in training data from file (libsvm format) */
-int read_problem(const char *filename);
-static char* readline(FILE *input)
+	Options() :
+		threads(0), partitions(0), workers(0), address(NULL), kernelType(MySVM::KERNEL_LINEAR),
+		gamma(0), engine(NULL), output(NULL), lazy(false), seed(1), cacheMB(CACHE_SIZE),
+		tolerance(EPS), maxPasses(1000), precision(17), batch(0), lambda(0), epochs(10), folds(5), repeats(3),
+		binary(true), online(false), map(MySVM::MAP_NONE), checkpoint(NULL), interval(60),
+		resume(NULL), progress(NULL), progressInterval(1), maxGap(0), maxSeconds(0), maxUpdates(0),
+		order(MySVM::ORDER_NONE), binding(MySVM::BIND_NONE), pages(MySVM::PAGES_MALLOC), quantize(false) {}
+};
+
+static void usage(const char *name)
 {
-	int len;
+	fprintf(stderr,
+			"usage: %s train [options] input_file      train and write the model with -o\n"
+			"       %s predict [options] model_file input_file\n"
+			"                                          accuracy, and label and f(x) per row with -o\n"
+			"       %s convert [-F text|binary] [-p digits] input_file output_file\n"
+			"       %s bench [options] input_file      time -n training runs and the predictions\n"
+			"       %s cv [options] [-v folds] input_file\n"
+			"                                          cross validation accuracy\n"
+			"       %s reduce [-B budget,...] [-o model_file] model_file input_file\n"
+			"                                          accuracy and latency of an RBF model reduced\n"
+			"                                          to each budget; -o writes the smallest\n"
+			"       %s train -O [options] [input_file|-]\n"
+			"                                          online training on a stream of records\n"
+			"       %s -W address                      run as a distributed worker\n"
+			"options:\n"
+			"  -t, --threads N       threads (0, the default, trains serially; the parallel SMO\n"
+			"                        loop gives the same result for every N, and scaling runs\n"
+			"                        compare it with serial training)\n"
+			"  -m, --cache MB        SMO kernel cache budget (default %d)\n"
+			"  -k, --kernel K        linear (default) or rbf\n"
+			"  -g, --gamma G         RBF width (default 1/features)\n"
+			"  -e, --engine E        smo, dcd or sgd; by default linear problems trained serially\n"
+			"                        use dual coordinate descent, everything else SMO\n"
+			"  -T, --tolerance TOL   KKT tolerance of smo and dcd (default %g)\n"
+			"  -M, --max-passes N    dcd passes before it gives up (default 1000)\n"
+			"  -p, --precision D     significant digits of the files written (default 17)\n"
+			"  -o, --output FILE     model file (train) or predictions (predict)\n"
+			"  -s, --seed S          seeds every random choice (default 1)\n"
+			"  -l, --lazy            serial SMO (and each cascade partition) keeps only the\n"
+			"                        non-bound errors current\n"
+			"  -c, --partitions P    cascade training over the threads\n"
+			"  -w, --workers N       distributed training; local workers are forked without -a\n"
+			"  -a, --address A       unix:/path or tcp:host:port of the coordinator\n"
+			"  -E, --epochs N        sgd passes over the data (default 10)\n"
+			"  -b, --batch N         sgd and online rows per step\n"
+			"  -L, --lambda L        sgd and online regularization (sgd: 1/(C rows) by default)\n"
+			"  -v, --folds N         cross validation folds (default 5)\n"
+			"  -n, --repeats N       bench training runs (default 3)\n"
+			"  -F, --format F        convert output, binary (default) or text\n"
+			"  -B, --budget N[,N..]  support vectors kept: train merges an RBF model down to N,\n"
+			"                        reduce reports each N, online training keeps N (default 500)\n"
+			"  -A, --map M           with -k rbf, train linearly on rff (random Fourier) or nystroem\n"
+			"                        features approximating the kernel\n"
+			"  -D, --dims D[,D..]    dimensions of the map (default 1000); cv reports each D\n"
+			"  -K, --checkpoint FILE smo saves its state to FILE every -I seconds (default 60)\n"
+			"  -I, --interval S      seconds between checkpoints\n"
+			"  -R, --resume FILE     smo continues from a checkpoint, and keeps saving to it\n"
+			"  -G, --gap G           smo stops once the duality gap is at most G times the primal\n"
+			"  -S, --max-seconds S   smo stops after S seconds of training\n"
+			"  -U, --max-updates N   smo stops after N pair updates\n"
+			"  -P, --progress FILE   smo appends JSON progress events to FILE (- for stderr), one\n"
+			"                        per pass and one every -i seconds within a pass\n"
+			"  -i, --progress-interval S\n"
+			"                        seconds between those events (default 1)\n"
+			"  -Y, --reorder O       smo trains on the rows ordered by label (label and norm) or\n"
+			"                        cluster (k-means, then label and norm); bench compares\n"
+			"                        the input order with O\n"
+			"  -N, --bind B          parallel smo pins its threads compact (node by node) or\n"
+			"                        spread (nodes in turn), and each thread first touches the\n"
+			"                        rows and errors it works on, so they sit on its NUMA node\n"
+			"  -H, --huge-pages M    smo keeps its dense rows, state and kernel cache on thp\n"
+			"                        (madvise) or hugetlb (reserved pool) huge pages, with a\n"
+			"                        fallback to plain pages; bench compares M with malloc\n"
+			"  -Q, --quantize int8   smo evaluates the rbf kernel on int8 rows, one scale per\n"
+			"                        feature; bench reports the accuracy against doubles\n"
+			"  -O, --online          with -B budget, -f to follow a growing file and\n"
+			"                        -r records between progress lines\n",
+			name, name, name, name, name, name, name, name, CACHE_SIZE, EPS);
+}
 
-	if (fgets(line, max_line_len, input) == NULL)
-		return NULL;
+/**	\brief Parses a whole number option value, which must span all of text
+ * 	\param name the option, for the message printed when the value is rejected
+ * 	\return false, with a message on stderr, if text is not a number in [min, max]
+ */
+static bool parse_long(const char *name, const char *text, long min, long max, long *value)
+{
+	char *end;
+	errno = 0;
+	*value = strtol(text, &end, 10);
+	if (end == text || *end != '\0' || errno == ERANGE)
+	{
+		fprintf(stderr, "%s must be a whole number, not %s\n", name, text);
+		return false;
+	}
+	if (*value < min || *value > max)
+	{
+		fprintf(stderr, "%s must be %s %ld, not %s\n", name, *value < min ? "at least" : "at most",
+				*value < min ? min : max, text);
+		return false;
+	}
+	return true;
+}
 
-	while (strrchr(line, '\n') == NULL)
+/**	\brief Parses a real option value, which must span all of text and be finite
+ * 	\param open whether min itself is rejected too
+ * 	\return false, with a message on stderr, if text is not a number above (or at) min
+ */
+static bool parse_double(const char *name, const char *text, double min, bool open, double *value)
+{
+	char *end;
+	*value = strtod(text, &end);
+	if (end == text || *end != '\0' || !std::isfinite(*value))
 	{
-		max_line_len *= 2;
-		line = (char *) realloc(line, max_line_len);
-		len = (int) strlen(line);
-		if (fgets(line + len, max_line_len - len, input) == NULL)
-			break;
+		fprintf(stderr, "%s must be a number, not %s\n", name, text);
+		return false;
 	}
-	return line;
+	if (*value < min || (open && *value == min))
+	{
+		fprintf(stderr, "%s must be %s %g, not %s\n", name, open ? "above" : "at least", min, text);
+		return false;
+	}
+	return true;
 }
 
-MySVM::Solver solver;
-double* x_space;
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
-/** \brief Initializes member variables of solver */
-void initSolver(); // initializes alphas, w[], etc for solver class object
+/**	\brief Opens a counter of the last level cache misses of this process and the threads it starts
+ * 	\return The descriptor, disabled, or -1 where the kernel or the machine offers no such counter
+ */
+static int open_llc_counter()
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.disabled = 1;
+	attr.inherit = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	int fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (fd < 0)
+	{
+		// the generic cache miss event counts last level misses on most CPUs
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	}
+	return fd;
+}
 
-/** \brief Simple test of svm on training data */
-void svm_eval();
+/** \brief Writes one progress event as a line of JSON */
+static void write_event(FILE *out, const char *event, const MySVM::Progress &p, const char *reason)
+{
+	fprintf(out, "{\"event\":\"%s\",\"pass\":%d,\"row\":%d,\"updates\":%lu,\"seconds\":%.3f,"
+			"\"dual\":%.10g,\"primal\":%.10g,\"gap\":%.6g,\"relative_gap\":%.6g,\"violation\":%.6g,"
+			"\"support_vectors\":%d,\"bound\":%d", event, p.passes, p.index, p.updates, p.seconds,
+			p.dual, p.primal, p.gap, p.gap / std::max(fabs(p.primal), 1e-300), p.violation,
+			p.supportVectors, p.boundVectors);
+	if (reason != NULL)
+	{
+		fprintf(out, ",\"reason\":\"%s\"", reason);
+	}
+	fprintf(out, "}\n");
+	fflush(out);
+}
 
-/**
- *	This is the main entry point for the svm training algorithm. Implements Platt's SMO for C-SVM
- * 
+/**	\brief Distributed SMO: trains as the coordinator of -w workers, forked locally without -a
+ *
+ * 	The coordinator keeps the sparse problem and the alphas; only the workers
+ * 	densify rows, each its own shard.
+ * 	\return Rounds of reports over the workers, or -1 on failure
  */
+static long train_distributed(const MySVM::Problem &prob, const Options &options, MySVM::Model *model,
+		bool verbose, double *seconds)
+{
+	double start = now();
+	MySVM::Coordinator coordinator(prob);
+	coordinator.kernelType = options.kernelType;
+	coordinator.gamma = (options.gamma > 0 || prob.features == 0) ? options.gamma : 1.0 / prob.features;
+	coordinator.tolerance = options.tolerance;
 
-int main(int argc, char **argv)
+	// without an address, fork local workers that talk over a unix socket
+	char local[64];
+	const char *address = options.address;
+	if (address == NULL)
+	{
+		snprintf(local, sizeof(local), "unix:/tmp/mysvm.%d.sock", (int) getpid());
+		address = local;
+		fflush(stdout);
+		for (int k = 0; k < options.workers; k++)
+		{
+			pid_t pid = fork();
+			if (pid == 0)
+			{
+				_exit(MySVM::runWorker(address));
+			}
+			if (pid < 0)
+			{
+				fprintf(stderr, "can't fork worker %d of %d: %s\n", k + 1, options.workers, strerror(errno));
+				for (size_t c = 0; c < coordinator.children.size(); c++)
+				{
+					kill(coordinator.children[c], SIGTERM);
+					waitpid(coordinator.children[c], NULL, 0);
+				}
+				return -1;
+			}
+			coordinator.children.push_back(pid);
+		}
+	}
+
+	// every round of reports counts as a pass
+	long passes = coordinator.train(address, options.workers);
+	for (size_t k = 0; k < coordinator.children.size(); k++)
+	{
+		if (passes < 0)
+		{
+			// workers that never got their shard would otherwise wait for it
+			kill(coordinator.children[k], SIGTERM);
+		}
+		waitpid(coordinator.children[k], NULL, 0);
+	}
+	*seconds = now() - start;
+	if (passes < 0)
+	{
+		std::clog << "distributed training failed, aborting" << std::endl;
+		return -1;
+	}
+
+	if (verbose)
+	{
+		const MySVM::Progress &p = coordinator.result;
+		printf("EXITING\n");
+		printf("trained in %.3f s (%ld passes, %d workers), dual objective %f\n",
+				*seconds, passes, options.workers, p.dual);
+		printf("convergence: %s after %lu updates, dual %f, primal %f, duality gap %g "
+				"(%.2e relative), KKT violation %g\n", coordinator.stopReason, coordinator.updates,
+				p.dual, p.primal, p.gap, p.gap / std::max(fabs(p.primal), 1e-300), p.violation);
+		printf("distributed: %d workers, %lu steps, %ld scans of all rows, %d support vectors "
+				"(%d at C)\n", options.workers, coordinator.updates, coordinator.scans,
+				p.supportVectors, p.boundVectors);
+	}
+	MySVM::build_model(coordinator, model);
+	return passes;
+}
+
+/**	\brief Trains a model on prob with the engine the options select
+ * 	\param verbose print the solver's report, as the train command does
+ * 	\param seconds set to the training time
+ * 	\param usage if not NULL, set to the memory of the smo rows and state and how much of it
+ * 	ended up on huge pages (the kernel cache only has one block to measure on huge pages)
+ * 	\return Passes (epochs for sgd) over the data, or -1 on failure
+ */
+static long train_model(const MySVM::Problem &prob, const Options &options, MySVM::Model *model,
+		bool verbose, double *seconds, MySVM::PageUsage *usage = NULL)
 {
-	// instantiate logging
-	std::clog.rdbuf(new Log("mysvm_log", LOG_LOCAL0));
-	std::clog << kLogNotice << "Log initialized..." << std::endl;
-	std::clog << "the default is debug level" << std::endl;
+	double start = now();
+
+	if (options.map != MySVM::MAP_NONE)
+	{
+		if (options.kernelType != MySVM::KERNEL_RBF)
+		{
+			fprintf(stderr, "feature maps approximate the rbf kernel, use -k rbf\n");
+			return -1;
+		}
+		double gamma = (options.gamma > 0 || prob.features == 0) ? options.gamma : 1.0 / prob.features;
+		int dim = options.dims.empty() ? 1000 : options.dims[0];
+		MySVM::FeatureMap map;
+		MySVM::Problem mapped;
+		try
+		{
+			if (options.map == MySVM::MAP_RFF)
+			{
+				map.fitRff(prob.features, gamma, dim, options.seed);
+			}
+			else
+			{
+				map.fitNystroem(prob, gamma, dim, options.seed);
+			}
+			map.apply(prob, &mapped, std::max(options.threads, 1));
+		}
+		catch (const std::bad_alloc &e)
+		{
+			fprintf(stderr, "a feature map of %d dimensions doesn't fit in memory\n", dim);
+			return -1;
+		}
+		double mapSeconds = now() - start;
+		if (verbose)
+		{
+			printf("feature map: %s, %d dimensions of %d features, gamma %g, mapped in %.3f s (%.1f MB)\n",
+					options.map == MySVM::MAP_RFF ? "random Fourier" : "Nystroem", map.dim,
+					prob.features, gamma, mapSeconds, mapped.bytes() / 1048576.0);
+		}
 
-	// initialize solver variables
-	initSolver();
+		// the mapped rows are trained like any linear problem
+		Options linear = options;
+		linear.kernelType = MySVM::KERNEL_LINEAR;
+		linear.map = MySVM::MAP_NONE;
+		long passes = train_model(mapped, linear, model, verbose, seconds);
+		*seconds += mapSeconds;
+		model->map = std::move(map);
+		return passes;
+	}
 
-	// read in data samples from file
-	char input_file_name[1024] =
-			"/home/mbarga/Workbench/gitrepos/mySVM/src/test.input";
-			//"/home/mbarga/Workbench/git/mySVM/src/test.input";
-	int status = read_problem(input_file_name);
-	if (status != 0)
+	bool dcd = (options.engine == NULL)
+			? options.kernelType == MySVM::KERNEL_LINEAR && options.threads == 0
+					&& options.partitions == 0 && options.workers == 0
+			: strcmp(options.engine, "dcd") == 0;
+	bool sgd = options.engine != NULL && strcmp(options.engine, "sgd") == 0;
+	if (options.engine != NULL && !dcd && !sgd && strcmp(options.engine, "smo") != 0)
 	{
-		std::clog << "failed to properly read in input, aborting" << std::endl;
-		return 1;
+		fprintf(stderr, "unknown engine %s\n", options.engine);
+		return -1;
 	}
+	if ((dcd || sgd) && options.kernelType != MySVM::KERNEL_LINEAR)
+	{
+		fprintf(stderr, "%s needs the linear kernel\n", dcd ? "dual coordinate descent" : "sgd");
+		return -1;
+	}
+	if ((options.checkpoint != NULL || options.resume != NULL)
+			&& (dcd || sgd || options.partitions > 0 || options.workers > 0))
+	{
+		fprintf(stderr, "checkpoints need smo training, serial or with -t\n");
+		return -1;
+	}
+	if (options.lazy && (dcd || sgd || options.workers > 0 || (options.threads > 0 && options.partitions == 0)))
+	{
+		fprintf(stderr, "lazy errors need serial smo training or the cascade, not -t alone\n");
+		return -1;
+	}
+	if ((options.progress != NULL || options.maxGap > 0 || options.maxSeconds > 0 || options.maxUpdates > 0)
+			&& (dcd || sgd || options.workers > 0))
+	{
+		fprintf(stderr, "stopping criteria and progress events need smo training\n");
+		return -1;
+	}
+	if (options.order != MySVM::ORDER_NONE && (dcd || sgd || options.workers > 0))
+	{
+		fprintf(stderr, "row reordering applies to smo training, serial, with -t or the cascade\n");
+		return -1;
+	}
+	if (options.binding != MySVM::BIND_NONE
+			&& (dcd || sgd || options.threads == 0 || options.partitions > 0 || options.workers > 0))
+	{
+		fprintf(stderr, "thread binding needs parallel smo training, -t N\n");
+		return -1;
+	}
+	if (options.pages != MySVM::PAGES_MALLOC && (dcd || sgd || options.workers > 0))
+	{
+		fprintf(stderr, "huge pages apply to smo training, serial, with -t or the cascade\n");
+		return -1;
+	}
+	if (options.quantize && (dcd || sgd || options.kernelType != MySVM::KERNEL_RBF
+			|| options.partitions > 0 || options.workers > 0))
+	{
+		// linear smo keeps w and its errors from the rows themselves
+		fprintf(stderr, "int8 rows apply to rbf smo training, serial or with -t\n");
+		return -1;
+	}
+	start = now();
+
+	if (sgd)
+	{
+		MySVM::SGDSolver pegasos(prob);
+		pegasos.seed = options.seed;
+		double lambda = (options.lambda > 0) ? options.lambda : 1.0 / (C * std::max(prob.length, 1));
+		long steps = pegasos.train(lambda, options.epochs, (options.batch > 0) ? options.batch : 8,
+				std::max(options.threads, 1));
+		*seconds = now() - start;
 
-	int index = 0;
-	int numChanged = 0;
-	bool examineAll = true;
+		if (verbose)
+		{
+			// the primal objective is comparable with the dual objective of the other engines
+			printf("EXITING\n");
+			printf("trained in %.3f s (%d epochs, %ld steps, %d threads, sgd), primal objective %f\n",
+					*seconds, options.epochs, steps, std::max(options.threads, 1), pegasos.objective(C));
+			printf("training accuracy %.2f%%, %ld stored features in %d rows\n",
+					100 * pegasos.accuracy(), prob.elements, prob.length);
 
-	while ((numChanged > 0) || examineAll)
+			std::cout << "w values were: " << std::endl;
+			for (size_t j = 0; j < pegasos.w.size(); j++)
+			{
+				std::cout << j << ": " << pegasos.w[j] << std::endl;
+			}
+			std::cout << "bias was: " << pegasos.b << std::endl;
+		}
+		MySVM::build_model(pegasos, model);
+		return options.epochs;
+	}
+
+	if (dcd)
 	{
-		numChanged = 0;
+		// linear problems train on the sparse rows directly, no dense copy is made
+		MySVM::LinearSolver linear(prob);
+		linear.seed = options.seed;
+		int passes = linear.train(C, options.tolerance, options.maxPasses);
+		*seconds = now() - start;
 
-		// OUTER LOOP (first lagrange multiplier)
-		// first, loop over entire training set 
-		if (examineAll)
+		if (verbose)
 		{
-			for (index = 0; index < solver.length; index++)
+			printf("EXITING\n");
+			printf("trained in %.3f s (%d passes, dual coordinate descent, %s), dual objective %f\n",
+					*seconds, passes, strcmp(linear.stopReason, "converged") == 0 ? "converged"
+							: "stopped at the pass limit", linear.objective());
+			printf("%d support vectors, %ld stored features in %d rows\n",
+					linear.supportVectors(), prob.elements, prob.length);
+
+			std::cout << "w values were: " << std::endl;
+			for (size_t j = 0; j < linear.w.size(); j++)
 			{
-				numChanged += solver.examine(index);
+				std::cout << j << ": " << linear.w[j] << std::endl;
 			}
+			std::cout << "bias was: " << linear.b << std::endl;
 		}
-		else // else iterate over multipliers that are not at the bounds
+		MySVM::build_model(linear, model);
+		return passes;
+	}
+
+	if (options.workers > 0)
+	{
+		return train_distributed(prob, options, model, verbose, seconds);
+	}
+
+	// SMO works on dense rows, in the order asked for; the dense copy is laid
+	// out in that order, and order maps the rows back for the output
+	MySVM::Solver solver;
+	MySVM::Problem reordered;
+	std::vector<int> permutation;
+	const MySVM::Problem *data = &prob;
+	if (options.order != MySVM::ORDER_NONE)
+	{
+		MySVM::order_rows(prob, options.order, options.seed, &permutation);
+		MySVM::subset_problem(prob, permutation, &reordered);
+		data = &reordered;
+		solver.order = permutation.data();
+		if (verbose)
 		{
-			for (index = 0; index < solver.length; index++)
+			printf("reordered rows by %s in %.3f s\n",
+					options.order == MySVM::ORDER_LABEL ? "label and norm" : "cluster", now() - start);
+		}
+	}
+
+	// with a binding, the threads of trainParallel() are pinned and the same
+	// pinned threads write the dense rows and the per-row state first, each
+	// its own chunk, so those pages are placed on the node that reads them
+	std::unique_ptr<MySVM::ThreadPool> placer;
+	if (options.binding != MySVM::BIND_NONE)
+	{
+		MySVM::Topology topology = MySVM::Topology::detect();
+		solver.cpus = MySVM::bind_cpus(topology, options.binding, options.threads);
+		placer.reset(new MySVM::ThreadPool(options.threads, solver.cpus));
+		if (verbose)
+		{
+			printf("numa: %d node%s (cpus %s), %d threads bound %s to cpus", (int) topology.nodes.size(),
+					topology.nodes.size() == 1 ? "" : "s", topology.describe().c_str(), options.threads,
+					options.binding == MySVM::BIND_COMPACT ? "compact" : "spread");
+			for (size_t t = 0; t < solver.cpus.size(); t++)
 			{
-				if ((solver.alpha[index] > EPS) && (solver.alpha[index] < (C - EPS)) && (solver.alpha[index] > (C + EPS)))
-				{
-					numChanged += solver.examine(index);
-				}
+				printf(" %d", solver.cpus[t]);
+			}
+			printf("%s\n", topology.nodes.size() == 1 ? "; one node, so only the pinning applies" : "");
+		}
+	}
+
+	// y stays owned by the problem, the rows by this scope (by rowBlock on huge pages)
+	double *x_space;
+	MySVM::PageBlock rowBlock;
+	bool huge = options.pages != MySVM::PAGES_MALLOC;
+	solver.length = data->length;
+	solver.features = data->features;
+	solver.y = data->y;
+	solver.x = MySVM::densify(*data, &x_space, placer.get(), huge ? &rowBlock : NULL, options.pages);
+	std::unique_ptr<double *, void (*)(void *)> rows(solver.x, free);
+	std::unique_ptr<double, void (*)(void *)> space(huge ? NULL : x_space, free);
+	solver.pages = options.pages;
+	MySVM::QuantizedRows quantized;
+	if (options.quantize)
+	{
+		double quantizeStart = now();
+		quantized.build(solver.x, data->length, data->features);
+		solver.quantized = &quantized;
+		if (verbose)
+		{
+			double dense = (double) data->length * data->features * sizeof(double);
+			printf("int8 rows: %.1f MB vs %.1f MB of doubles, %s scale", quantized.bytes() / 1048576.0,
+					dense / 1048576.0, quantized.uniform ? "one" : "per feature");
+			if (quantized.uniform)
+			{
+				printf(" %g", quantized.scale);
 			}
+			printf(", %s dot products, largest error %g, quantized in %.3f s\n", quantized.kernelName(),
+					quantized.maxError, now() - quantizeStart);
 		}
+	}
+	solver.kernelType = options.kernelType;
+	solver.gamma = (options.gamma > 0 || prob.features == 0) ? options.gamma : 1.0 / prob.features;
+	solver.lazyErrors = options.lazy;
+	solver.seed = options.seed;
+	solver.tolerance = options.tolerance;
 
-		// if subset was unchanged, loop over entire set again
-		if (examineAll)
+	// initialize solver variables (sized from the problem just read); -m 0
+	// still gets a cache, of the two columns it is raised to
+	solver.init(std::max(options.cacheMB * 1024UL * 1024UL, 1UL), placer.get());
+	if (placer)
+	{
+		if (placer->pinError() != 0)
+		{
+			// the rows are still split among the threads, just not pinned
+			fprintf(stderr, "can't pin threads (%s), training unpinned\n", strerror(placer->pinError()));
+			solver.cpus.clear();
+		}
+		placer.reset();
+	}
+	if (options.resume != NULL)
+	{
+		if (MySVM::Checkpointer::load(options.resume, &solver) != 0)
 		{
-			examineAll = false;
+			fprintf(stderr, "can't resume from %s: unreadable, or taken on other data or settings\n",
+					options.resume);
+			return -1;
 		}
-		else if (numChanged == 0)
+		if (verbose)
 		{
-			examineAll = true;
+			printf("resumed from %s: pass %d, row %d, %lu updates\n", options.resume,
+					solver.loop.passes, solver.loop.index, solver.updates);
+		}
+	}
+	std::unique_ptr<MySVM::Checkpointer> checkpointer;
+	const char *checkpoint = (options.checkpoint != NULL) ? options.checkpoint : options.resume;
+	if (checkpoint != NULL)
+	{
+		checkpointer.reset(new MySVM::Checkpointer(checkpoint, options.interval));
+		solver.checkpointer = checkpointer.get();
+	}
+	solver.maxGap = options.maxGap;
+	solver.maxSeconds = options.maxSeconds;
+	solver.maxUpdates = options.maxUpdates;
+	solver.progressInterval = options.progressInterval;
+	std::unique_ptr<FILE, int (*)(FILE *)> events(NULL, fclose);
+	FILE *eventsOut = NULL;
+	if (options.progress != NULL)
+	{
+		if (strcmp(options.progress, "-") != 0)
+		{
+			events.reset(fopen(options.progress, "a"));
+			if (!events)
+			{
+				fprintf(stderr, "can't write progress events to %s\n", options.progress);
+				return -1;
+			}
 		}
+		eventsOut = events ? events.get() : stderr;
+		solver.progress = [eventsOut](const MySVM::Progress &p) { write_event(eventsOut, "progress", p, NULL); };
 	}
+	start = now();
 
-	printf("EXITING\n");
+	int threads = options.threads;
+	long passes = 0;
+	if (options.partitions > 0)
+	{
+		int rounds;
+		passes = MySVM::trainCascade(solver, options.partitions, std::max(threads, 1), 3, &rounds);
+		if (verbose)
+		{
+			printf("cascade: %d partitions, %d feedback rounds\n", options.partitions, rounds);
+		}
+	}
+	else
+	{
+		passes = (threads > 0) ? solver.trainParallel(threads) : solver.train();
+	}
+	*seconds = now() - start;
 
-	solver.print();
+	if (verbose && passes >= 0)
+	{
+		printf("EXITING\n");
+		printf("trained in %.3f s (%ld passes, %d threads), dual objective %f\n",
+				*seconds, passes, std::max(threads, 1), solver.objective());
+		MySVM::Progress p;
+		solver.measure(&p);
+		printf("convergence: %s after %lu updates, dual %f (tracked %f), primal %f, duality gap %g "
+				"(%.2e relative), KKT violation %g\n", solver.stopReason, solver.updates,
+				solver.objective(), p.dual, p.primal, p.gap, p.gap / std::max(fabs(p.primal), 1e-300),
+				p.violation);
+		if (checkpointer)
+		{
+			// the writes happen on their own thread; only the copies hold up training
+			checkpointer->wait();
+			printf("checkpoints: %lu written to %s (%lu superseded, %lu failed), %.1f MB each, "
+					"%.4f s copying (%.2f%% of training), %.3f s writing in the background\n",
+					checkpointer->written, checkpoint, checkpointer->superseded, checkpointer->failures,
+					checkpointer->bytes / 1048576.0, checkpointer->copySeconds,
+					*seconds > 0 ? 100 * checkpointer->copySeconds / *seconds : 0.0,
+					checkpointer->writeSeconds);
+		}
 
-	svm_eval();
+		solver.print();
+		double dense = (double) prob.length * prob.features * sizeof(double);
+		printf("dense rows: %.1f MB (%.0f bytes per row)\n", dense / 1048576.0,
+				prob.length ? dense / prob.length : 0.0);
+	}
 
-//	free(solver.alpha);
-//	free(solver.error);
-//	free(solver.randi);
-//	free(solver.w);
-//	free(solver.x);
-//	free(solver.y);
+	// counted after training: transparent huge pages are only there once touched
+	if ((verbose && huge) || usage != NULL)
+	{
+		MySVM::PageUsage parts[3] = {
+			MySVM::page_usage(x_space, (size_t) data->length * data->features * sizeof(double)),
+			solver.stateUsage(), solver.cache->usage()
+		};
+		if (verbose && huge)
+		{
+			static const char *names[] = { "rows", "state", "kernel cache" };
+			printf("huge pages (%s, rows on %s):", MySVM::page_mode_name(options.pages),
+					MySVM::page_mode_name(rowBlock.mode()));
+			for (int k = 0; k < 3; k++)
+			{
+				printf("%s %s %.1f of %.1f MB", k ? "," : "", names[k], parts[k].huge / 1048576.0,
+						parts[k].bytes / 1048576.0);
+			}
+			printf("\n");
+		}
+		if (usage != NULL)
+		{
+			*usage = parts[0];
+			usage->add(parts[1]);
+		}
+	}
+
+	if (eventsOut != NULL && passes >= 0)
+	{
+		MySVM::Progress p;
+		solver.measure(&p);
+		write_event(eventsOut, "done", p, solver.stopReason);
+	}
+
+	MySVM::build_model(solver, model);
+	return passes;
+}
 
+static int read_input(const char *filename, MySVM::Problem *prob)
+{
+	// libsvm text or the binary format of dataset.h
+	if (MySVM::read_problem(filename, prob) != 0)
+	{
+		std::clog << "failed to properly read in input, aborting" << std::endl;
+		fprintf(stderr, "malformed input file %s\n", filename);
+		return 1;
+	}
 	return 0;
-} // main
+}
 
-void initSolver()
+/**	\brief Reduces an RBF model to the first -B budget, then reports its compaction and
+ * 	training set accuracy, after train and bench
+ */
+static void report_model(const Options &options, const MySVM::Problem &prob, MySVM::Model *model)
 {
-	//TODO: bad style? ********************************
-	//TODO: initialize error|alphas|y differently?
-	//TOOD: deinit - free all memories!! (run memcheck stuff)
+	if (!options.budgets.empty() && model->kernelType == MySVM::KERNEL_RBF)
+	{
+		double error;
+		size_t before = model->sv.size();
+		double start = now();
+		MySVM::reduce_model(model, options.budgets[0], &error);
+		printf("reduced set: %lu -> %lu support vectors in %.3f s, feature space error %g\n",
+				(unsigned long) before, (unsigned long) model->sv.size(), now() - start, error);
+	}
 
-	solver.alpha = Malloc(double, solver.length);
-	solver.error = Malloc(double, solver.length);
-	solver.randi = Malloc(int, solver.length);
-	solver.w = Malloc(double, solver.features);
+	// prediction keeps only the support vectors, packed with their coefficients
+	MySVM::CompactModel compact(*model);
+	if (compact.kernelType != MySVM::KERNEL_LINEAR)
+	{
+		double rows = (double) prob.length * prob.features * sizeof(double);
+		printf("compaction: %d support vectors of %d rows (%.1f%%), %.2f MB %s vs %.2f MB of dense "
+				"training rows, %.1f%% saved\n", compact.count, prob.length,
+				prob.length ? 100.0 * compact.count / prob.length : 0.0, compact.bytes() / 1048576.0,
+				compact.dense ? "dense" : "sparse", rows / 1048576.0,
+				rows > 0 ? 100 * (1 - compact.bytes() / rows) : 0.0);
+	}
+	if (model->map.type == MySVM::MAP_NONE)
+	{
+		MySVM::evaluate(compact, prob, options.threads, NULL).print("training set");
+	}
+	else
+	{
+		MySVM::evaluate(*model, prob, options.threads, NULL).print("training set");
+	}
+}
 
-	solver.b = 0;
+static int train(const Options &options, const char *input)
+{
+	MySVM::Problem prob;
+	if (read_input(input, &prob) != 0)
+	{
+		return 1;
+	}
 
-	for (int i = 0; i < solver.length; i++)
+	MySVM::Model model;
+	double seconds;
+	if (train_model(prob, options, &model, true, &seconds) < 0)
 	{
-		solver.error[i] = -solver.y[i]; // init error to opposite signed y (other side of the separating margin)
-		solver.alpha[i] = 0;
-		solver.randi[i] = i;
+		return 1;
 	}
 
-	for (int j = 0; j < solver.features; j++)
+	report_model(options, prob, &model);
+
+	// ru_maxrss is in kB; the peak covers loading, training and the model
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	double peak = usage.ru_maxrss * 1024.0;
+	printf("memory: peak %.1f MB resident (%.0f bytes per row), problem %.1f MB\n",
+			peak / 1048576.0, prob.length ? peak / prob.length : 0.0, prob.bytes() / 1048576.0);
+
+	if (options.output != NULL)
 	{
-		solver.w[j] = 0;
+		try
+		{
+			MySVM::save_model(options.output, model, options.precision);
+		}
+		catch (const std::runtime_error &e)
+		{
+			fprintf(stderr, "can't write model file %s\n", options.output);
+			return 1;
+		}
 	}
-	//*************************************************
+	return 0;
 }
 
-// read in a problem (in svmlight format)
-int read_problem(const char *filename)
+static int predict(const Options &options, const char *model_file, const char *input)
 {
-	int max_index, inst_max_index, i, j;
-	FILE *fp = fopen(filename, "r");
-	char *endptr;
-	char *idx, *val, *label;
-	//int length = 0 elements = 0;
+	MySVM::Model model;
+	if (MySVM::load_model(model_file, &model) != 0)
+	{
+		fprintf(stderr, "can't read model file %s\n", model_file);
+		return 1;
+	}
+	MySVM::Problem prob;
+	if (read_input(input, &prob) != 0)
+	{
+		return 1;
+	}
 
-	solver.length = 0;
-	solver.features = 0;
-	int elements = 0;
+	std::vector<double> values;
+	MySVM::evaluate(model, prob, options.threads, &values).print("predict");
 
-	if (fp == NULL)
+	if (options.output != NULL)
 	{
-		fprintf(stderr, "can't open input file %s\n", filename);
-		exit(1);
+		FILE *out = fopen(options.output, "w");
+		bool ok = out != NULL;
+		for (int i = 0; ok && i < prob.length; i++)
+		{
+			ok = fprintf(out, "%d %.*g\n", values[i] > 0 ? 1 : -1, options.precision, values[i]) > 0;
+		}
+		if (out == NULL || fclose(out) != 0 || !ok)
+		{
+			fprintf(stderr, "can't write predictions to %s\n", options.output);
+			return 1;
+		}
 	}
+	return 0;
+}
 
-	max_line_len = 1024;
-	line = Malloc(char,max_line_len);
-	int stop = 0;
-	while (readline(fp) != NULL)
+static int convert(const Options &options, const char *input, const char *output)
+{
+	MySVM::Problem prob;
+	if (read_input(input, &prob) != 0)
 	{
-		char *p = strtok(line, " \t"); // label
+		return 1;
+	}
+	try
+	{
+		MySVM::write_problem(output, prob, options.binary, options.precision);
+	}
+	catch (const std::runtime_error &e)
+	{
+		fprintf(stderr, "can't write %s\n", output);
+		return 1;
+	}
+	printf("%d rows, %d features, %ld stored features written to %s (%s)\n", prob.length,
+			prob.features, prob.elements, output, options.binary ? "binary" : "text");
+	return 0;
+}
+
+static int bench(const Options &options, const char *input)
+{
+	MySVM::Problem prob;
+	if (read_input(input, &prob) != 0)
+	{
+		return 1;
+	}
 
-		// features
-		while (1)
+	// with a row order, huge pages or int8 rows, input order on malloc'd pages of
+	// doubles runs first as the baseline
+	static const char *names[] = { "input", "label", "cluster" };
+	std::vector<Options> runs(1, options);
+	runs[0].order = MySVM::ORDER_NONE;
+	runs[0].pages = MySVM::PAGES_MALLOC;
+	runs[0].quantize = false;
+	if (options.order != MySVM::ORDER_NONE || options.pages != MySVM::PAGES_MALLOC || options.quantize)
+	{
+		runs.push_back(options);
+	}
+	int counter = open_llc_counter();
+	int counterError = errno;
+	std::vector<double> medians, misses;
+	std::vector<MySVM::PageUsage> usages;
+	std::vector<double> accuracies;
+	std::vector<std::string> labels;
+	MySVM::Model model;
+	for (size_t o = 0; o < runs.size(); o++)
+	{
+		const Options &run = runs[o];
+		labels.push_back(std::string(names[run.order]) + " order, " + MySVM::page_mode_name(run.pages) + " pages"
+				+ (run.quantize ? ", int8 rows" : ""));
+		std::vector<double> times, counts;
+		MySVM::PageUsage usage;
+		for (int r = 0; r < std::max(options.repeats, 1); r++)
 		{
-			p = strtok(NULL, " \t");
-			if (p == NULL || *p == '\n')
-			{// check '\n' as ' ' may be after the last feature
-				if (stop == 0)
+			double seconds;
+			long long count = 0;
+			if (counter >= 0)
+			{
+				ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+				ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+			}
+			long passes = train_model(prob, run, &model, false, &seconds, &usage);
+			if (counter >= 0)
+			{
+				ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+				if (read(counter, &count, sizeof(count)) != sizeof(count))
 				{
-					stop = 1;
-					++solver.features;
+					count = 0;
 				}
-				break;
 			}
-			if (stop == 0)
+			if (passes < 0)
 			{
-				++solver.features;
+				return 1;
 			}
-			++elements;
+			printf("run %d%s%s: trained in %.3f s (%ld passes)", r + 1, runs.size() > 1 ? ", " : "",
+					runs.size() > 1 ? labels[o].c_str() : "", seconds, passes);
+			if (usage.bytes > 0)
+			{
+				printf(", rows and state %.1f of %.1f MB on huge pages", usage.huge / 1048576.0,
+						usage.bytes / 1048576.0);
+			}
+			if (counter >= 0)
+			{
+				printf(", %lld LLC misses", count);
+			}
+			printf("\n");
+			times.push_back(seconds);
+			counts.push_back((double) count);
+		}
+		std::sort(times.begin(), times.end());
+		std::sort(counts.begin(), counts.end());
+		printf("train: min %.3f s, median %.3f s, max %.3f s over %lu runs\n",
+				times.front(), times[times.size() / 2], times.back(), (unsigned long) times.size());
+		medians.push_back(times[times.size() / 2]);
+		misses.push_back(counts[counts.size() / 2]);
+		usages.push_back(usage);
+		if (runs.size() > 1)
+		{
+			accuracies.push_back(MySVM::evaluate(model, prob, options.threads, NULL).accuracy());
+		}
+	}
+	if (runs.size() > 1)
+	{
+		// misses cover the whole training call, the dense copy of the rows included
+		for (size_t o = 0; o < runs.size(); o++)
+		{
+			// both runs are smo, which reports its pages
+			printf("%s%s %.3f s (%.0f%% huge", o ? " -> " : "", labels[o].c_str(), medians[o],
+					100.0 * usages[o].huge / std::max(usages[o].bytes, (size_t) 1));
+			if (counter >= 0)
+			{
+				printf(", %.0f LLC misses", misses[o]);
+				if (o > 0)
+				{
+					printf(", %+.1f%%", misses[0] > 0 ? 100 * (misses[o] / misses[0] - 1) : 0.0);
+				}
+			}
+			printf(")");
 		}
-		++elements;
-		++solver.length;
+		printf(", %.2fx\n", medians[0] / std::max(medians[1], 1e-9));
+		printf("training set accuracy: %.2f%% -> %.2f%% (%+.2f points)\n", 100 * accuracies[0],
+				100 * accuracies[1], 100 * (accuracies[1] - accuracies[0]));
 	}
-	rewind(fp);
+	if (counter < 0)
+	{
+		printf("LLC misses: no counter (perf_event_open: %s)\n", strerror(counterError));
+	}
+	else
+	{
+		close(counter);
+	}
+
+	printf("predict on %d threads:\n", std::max(options.threads, 1));
 
-	solver.y = Malloc(double, solver.length);
-	solver.x = Malloc(double *, solver.length);
-	x_space = Malloc(double, elements);
+	report_model(options, prob, &model);
+	return 0;
+}
 
-	max_index = 0;
-	j = 0;
-	for (i = 0; i < solver.length; i++)
+/**	\brief Trains on all folds but one and scores that one, for each fold in turn
+ * 	\param order the rows, shuffled; row order[k] is tested in fold k % folds
+ * 	\param verbose print a line per fold
+ * 	\param seconds set to the summed training time
+ * 	\return The pooled counts with the mean AUC of the folds, rows < 0 on failure
+ */
+static MySVM::Evaluation cross_validate(const MySVM::Problem &prob, const std::vector<int> &order,
+		int folds, const Options &options, bool verbose, double *seconds)
+{
+	MySVM::Evaluation total;
+	*seconds = 0;
+	for (int f = 0; f < folds; f++)
 	{
-		inst_max_index = -1; // strtol gives 0 if wrong format, and precomputed kernel has <index> start from 0
-		readline(fp);
-		solver.x[i] = &x_space[j];
-		label = strtok(line, " \t\n");
-		if (label == NULL) // empty line
-			return 1;
+		std::vector<int> trainRows, testRows;
+		for (int k = 0; k < prob.length; k++)
+		{
+			(k % folds == f ? testRows : trainRows).push_back(order[k]);
+		}
+		MySVM::Problem trainSet, testSet;
+		MySVM::subset_problem(prob, trainRows, &trainSet);
+		MySVM::subset_problem(prob, testRows, &testSet);
+
+		MySVM::Model model;
+		double trainSeconds;
+		if (train_model(trainSet, options, &model, false, &trainSeconds) < 0)
+		{
+			total.rows = -1;
+			return total;
+		}
+		MySVM::Evaluation fold = MySVM::evaluate(model, testSet, options.threads, NULL);
+		if (verbose)
+		{
+			printf("fold %d: accuracy %.2f%% (%ld/%ld), AUC %.4f, trained in %.3f s\n", f + 1,
+					100 * fold.accuracy(), fold.truePositives + fold.trueNegatives, fold.rows, fold.auc,
+					trainSeconds);
+		}
+
+		// pooled counts; the AUC is the mean over the folds
+		total.rows += fold.rows;
+		total.truePositives += fold.truePositives;
+		total.falsePositives += fold.falsePositives;
+		total.trueNegatives += fold.trueNegatives;
+		total.falseNegatives += fold.falseNegatives;
+		total.auc += fold.auc / folds;
+		total.seconds += fold.seconds;
+		*seconds += trainSeconds;
+	}
+	return total;
+}
 
-		solver.y[i] = strtod(label, &endptr);
-		if (endptr == label || *endptr != '\0')
+static int cv(const Options &options, const char *input)
+{
+	MySVM::Problem prob;
+	if (read_input(input, &prob) != 0)
+	{
+		return 1;
+	}
+	int folds = std::min(std::max(options.folds, 2), std::max(prob.length, 2));
+
+	// folds are taken from a seeded shuffle of the rows
+	std::vector<int> order(prob.length);
+	for (int i = 0; i < prob.length; i++)
+	{
+		order[i] = i;
+	}
+	MySVM::Random rng(options.seed);
+	if (prob.length > 0)
+	{
+		rng.shuffle(&order[0], prob.length);
+	}
+
+	double seconds;
+	if (options.map == MySVM::MAP_NONE || options.dims.size() < 2)
+	{
+		MySVM::Evaluation total = cross_validate(prob, order, folds, options, true, &seconds);
+		if (total.rows < 0)
+		{
 			return 1;
+		}
+		printf("cross validation: %d folds, %.3f s training\n", folds, seconds);
+		total.print("cross validation");
+		return 0;
+	}
 
-		while (1)
+	// the same folds for every dimension of the map
+	printf("%s features, %d folds: training time (mapping included) and accuracy by dimension\n",
+			options.map == MySVM::MAP_RFF ? "random Fourier" : "Nystroem", folds);
+	printf("%8s %12s %10s %8s %14s\n", "D", "train s", "accuracy", "AUC", "predict rows/s");
+	for (size_t k = 0; k < options.dims.size(); k++)
+	{
+		Options single = options;
+		single.dims.assign(1, options.dims[k]);
+		MySVM::Evaluation total = cross_validate(prob, order, folds, single, false, &seconds);
+		if (total.rows < 0)
 		{
-			idx = strtok(NULL, ":");
-			val = strtok(NULL, " \t");
+			return 1;
+		}
+		printf("%8d %12.3f %9.2f%% %8.4f %14.0f\n", options.dims[k], seconds, 100 * total.accuracy(),
+				total.auc, total.rows / std::max(total.seconds, 1e-9));
+	}
+	return 0;
+}
 
-			if (val == NULL)
-				break;
+/** \brief Scores the rows one at a time, as an online caller would, and reports the latency per row */
+static void latency(const MySVM::CompactModel &model, const MySVM::Problem &prob,
+		double *mean, double *p50, double *p99)
+{
+	int rows = std::min(prob.length, 20000);
+	std::vector<double> scratch, times(rows);
+	double sum = 0;
+	for (int i = 0; i < rows; i++)
+	{
+		double start = now();
+		volatile double f = MySVM::decision_value(model, prob.x[i], &scratch);
+		(void) f;
+		times[i] = now() - start;
+		sum += times[i];
+	}
+	std::sort(times.begin(), times.end());
+	*mean = rows ? sum / rows : 0;
+	*p50 = rows ? times[rows / 2] : 0;
+	*p99 = rows ? times[rows * 99 / 100] : 0;
+}
 
-			//x_space[j].index = (int) strtol(idx,&endptr,10);
-			if (endptr == idx || *endptr != '\0') //|| x_space[j].index <= inst_max_index)
-				return 1;
-			else
-				inst_max_index = (int) strtol(idx, &endptr, 10); //x_space[j].index;
+static int reduce(const Options &options, const char *model_file, const char *input)
+{
+	MySVM::Model model;
+	if (MySVM::load_model(model_file, &model) != 0)
+	{
+		fprintf(stderr, "can't read model file %s\n", model_file);
+		return 1;
+	}
+	if (model.kernelType != MySVM::KERNEL_RBF)
+	{
+		fprintf(stderr, "only RBF models have support vectors to reduce\n");
+		return 1;
+	}
+	MySVM::Problem prob;
+	if (read_input(input, &prob) != 0)
+	{
+		return 1;
+	}
 
-			x_space[j] = strtod(val, &endptr);
-			if (endptr == val || (*endptr != '\0' && !isspace(*endptr)))
-				return 1;
+	// largest budget first, so that each model is merged on from the previous one
+	std::vector<int> budgets = options.budgets;
+	if (budgets.empty())
+	{
+		int defaults[] = { 1000, 500, 200, 100, 50 };
+		budgets.assign(defaults, defaults + 5);
+	}
+	std::sort(budgets.rbegin(), budgets.rend());
 
-			++j;
+	printf("%8s %8s %9s %7s %10s %10s %10s %12s\n", "budget", "vectors", "accuracy", "AUC",
+			"mean us", "p50 us", "p99 us", "error");
+	double error = 0;
+	for (int k = -1; k < (int) budgets.size(); k++)
+	{
+		double merged = 0;
+		if (k >= 0)
+		{
+			MySVM::reduce_model(&model, budgets[k], &merged);
+			error += merged;
 		}
+		MySVM::CompactModel compact(model);
+		MySVM::Evaluation e = MySVM::evaluate(compact, prob, options.threads, NULL);
+		double mean, p50, p99;
+		latency(compact, prob, &mean, &p50, &p99);
 
-		if (inst_max_index > max_index)
-			max_index = inst_max_index;
-		//x_space[j++].index = -1;
+		char label[16] = "full";
+		if (k >= 0)
+		{
+			snprintf(label, sizeof(label), "%d", budgets[k]);
+		}
+		printf("%8s %8d %8.2f%% %7.4f %10.2f %10.2f %10.2f %12g\n", label, compact.count,
+				100 * e.accuracy(), e.auc, 1e6 * mean, 1e6 * p50, 1e6 * p99, error);
 	}
 
-	free(x_space);
-
-	fclose(fp);
+	if (options.output != NULL)
+	{
+		try
+		{
+			MySVM::save_model(options.output, model, options.precision);
+		}
+		catch (const std::runtime_error &e)
+		{
+			fprintf(stderr, "can't write model file %s\n", options.output);
+			return 1;
+		}
+	}
 	return 0;
 }
 
-// simple test evaluation on the training data
-void svm_eval()
+/**
+ *	This is the main entry point for the svm training algorithm. Implements Platt's SMO for C-SVM
+ *	and the other engines, behind the commands listed by usage(); without a command, train is assumed.
+ */
+
+int main(int argc, char **argv)
 {
-	double kernel = 0;
-	for (int i = 0; i < solver.length; i++)
+	// instantiate logging
+	std::clog.rdbuf(new Log("mysvm_log", LOG_LOCAL0));
+	std::clog << kLogNotice << "Log initialized..." << std::endl;
+	std::clog << "the default is debug level" << std::endl;
+
+	const char *name = argv[0];
+	const char *command = "train";
+	if (argc > 1 && (strcmp(argv[1], "train") == 0 || strcmp(argv[1], "predict") == 0
+			|| strcmp(argv[1], "convert") == 0 || strcmp(argv[1], "bench") == 0
+			|| strcmp(argv[1], "cv") == 0 || strcmp(argv[1], "reduce") == 0))
 	{
-		for (int j = 0; j < solver.features; j++)
+		command = argv[1];
+		--argc;
+		++argv;
+	}
+
+	static const struct option longOptions[] = {
+		{ "threads", required_argument, NULL, 't' },
+		{ "cache", required_argument, NULL, 'm' },
+		{ "kernel", required_argument, NULL, 'k' },
+		{ "gamma", required_argument, NULL, 'g' },
+		{ "engine", required_argument, NULL, 'e' },
+		{ "tolerance", required_argument, NULL, 'T' },
+		{ "max-passes", required_argument, NULL, 'M' },
+		{ "precision", required_argument, NULL, 'p' },
+		{ "output", required_argument, NULL, 'o' },
+		{ "seed", required_argument, NULL, 's' },
+		{ "lazy", no_argument, NULL, 'l' },
+		{ "partitions", required_argument, NULL, 'c' },
+		{ "workers", required_argument, NULL, 'w' },
+		{ "address", required_argument, NULL, 'a' },
+		{ "worker", required_argument, NULL, 'W' },
+		{ "epochs", required_argument, NULL, 'E' },
+		{ "batch", required_argument, NULL, 'b' },
+		{ "lambda", required_argument, NULL, 'L' },
+		{ "folds", required_argument, NULL, 'v' },
+		{ "repeats", required_argument, NULL, 'n' },
+		{ "format", required_argument, NULL, 'F' },
+		{ "online", no_argument, NULL, 'O' },
+		{ "budget", required_argument, NULL, 'B' },
+		{ "follow", no_argument, NULL, 'f' },
+		{ "report", required_argument, NULL, 'r' },
+		{ "map", required_argument, NULL, 'A' },
+		{ "dims", required_argument, NULL, 'D' },
+		{ "checkpoint", required_argument, NULL, 'K' },
+		{ "interval", required_argument, NULL, 'I' },
+		{ "resume", required_argument, NULL, 'R' },
+		{ "gap", required_argument, NULL, 'G' },
+		{ "max-seconds", required_argument, NULL, 'S' },
+		{ "max-updates", required_argument, NULL, 'U' },
+		{ "progress", required_argument, NULL, 'P' },
+		{ "progress-interval", required_argument, NULL, 'i' },
+		{ "reorder", required_argument, NULL, 'Y' },
+		{ "bind", required_argument, NULL, 'N' },
+		{ "huge-pages", required_argument, NULL, 'H' },
+		{ "quantize", required_argument, NULL, 'Q' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+
+	Options options;
+	long number;
+	int opt;
+	while ((opt = getopt_long(argc, argv, "t:m:k:g:e:T:M:p:o:s:lc:w:a:W:E:b:L:v:n:F:OB:fr:A:D:K:I:R:G:S:U:P:i:Y:N:H:Q:h",
+			longOptions, NULL)) != -1)
+	{
+		switch (opt)
 		{
-			kernel += solver.x[i][j] * solver.w[j];
+		case 't':
+			if (!parse_long("--threads", optarg, 0, INT_MAX, &number))
+			{
+				return 1;
+			}
+			options.threads = (int) number;
+			break;
+		case 'm':
+			if (!parse_long("--cache", optarg, 0, LONG_MAX >> 20, &number))
+			{
+				return 1;
+			}
+			options.cacheMB = number;
+			break;
+		case 'k':
+			if (strcmp(optarg, "rbf") != 0 && strcmp(optarg, "linear") != 0)
+			{
+				fprintf(stderr, "unknown kernel %s\n", optarg);
+				return 1;
+			}
+			options.kernelType = (strcmp(optarg, "rbf") == 0) ? MySVM::KERNEL_RBF : MySVM::KERNEL_LINEAR;
+			break;
+		case 'g':
+			if (!parse_double("--gamma", optarg, 0, false, &options.gamma))
+			{
+				return 1;
+			}
+			break;
+		case 'e':
+			options.engine = optarg;
+			break;
+		case 'T':
+			if (!parse_double("--tolerance", optarg, 0, true, &options.tolerance))
+			{
+				return 1;
+			}
+			break;
+		case 'M':
+			if (!parse_long("--max-passes", optarg, 1, INT_MAX, &number))
+			{
+				return 1;
+			}
+			options.maxPasses = (int) number;
+			break;
+		case 'p':
+			if (!parse_long("--precision", optarg, 1, 17, &number))
+			{
+				return 1;
+			}
+			options.precision = (int) number;
+			break;
+		case 'o':
+			options.output = optarg;
+			break;
+		case 's':
+			if (!parse_long("--seed", optarg, 0, LONG_MAX, &number))
+			{
+				return 1;
+			}
+			options.seed = (uint64_t) number;
+			break;
+		case 'l':
+			options.lazy = true;
+			break;
+		case 'c':
+			if (!parse_long("--partitions", optarg, 0, INT_MAX, &number))
+			{
+				return 1;
+			}
+			options.partitions = (int) number;
+			break;
+		case 'w':
+			if (!parse_long("--workers", optarg, 0, INT_MAX, &number))
+			{
+				return 1;
+			}
+			options.workers = (int) number;
+			break;
+		case 'a':
+			options.address = optarg;
+			break;
+		case 'W':
+			return MySVM::runWorker(optarg);
+		case 'E':
+			if (!parse_long("--epochs", optarg, 1, INT_MAX, &number))
+			{
+				return 1;
+			}
+			options.epochs = (int) number;
+			break;
+		case 'b':
+			if (!parse_long("--batch", optarg, 0, INT_MAX, &number))
+			{
+				return 1;
+			}
+			options.batch = (int) number;
+			break;
+		case 'L':
+			if (!parse_double("--lambda", optarg, 0, false, &options.lambda))
+			{
+				return 1;
+			}
+			break;
+		case 'v':
+			if (!parse_long("--folds", optarg, 2, INT_MAX, &number))
+			{
+				return 1;
+			}
+			options.folds = (int) number;
+			break;
+		case 'n':
+			if (!parse_long("--repeats", optarg, 1, INT_MAX, &number))
+			{
+				return 1;
+			}
+			options.repeats = (int) number;
+			break;
+		case 'F':
+			if (strcmp(optarg, "binary") != 0 && strcmp(optarg, "text") != 0)
+			{
+				fprintf(stderr, "unknown format %s\n", optarg);
+				return 1;
+			}
+			options.binary = strcmp(optarg, "binary") == 0;
+			break;
+		case 'O':
+			options.online = true;
+			break;
+		case 'B':
+			for (char *p = optarg, *end; *p != '\0'; p = end + (*end == ','))
+			{
+				long budget = strtol(p, &end, 10);
+				if (end == p || budget < 1 || budget > INT_MAX)
+				{
+					fprintf(stderr, "malformed budgets %s\n", optarg);
+					return 1;
+				}
+				options.budgets.push_back((int) budget);
+			}
+			break;
+		case 'A':
+			if (strcmp(optarg, "rff") != 0 && strcmp(optarg, "nystroem") != 0)
+			{
+				fprintf(stderr, "unknown feature map %s\n", optarg);
+				return 1;
+			}
+			options.map = (strcmp(optarg, "rff") == 0) ? MySVM::MAP_RFF : MySVM::MAP_NYSTROEM;
+			break;
+		case 'D':
+			for (char *p = optarg, *end; *p != '\0'; p = end + (*end == ','))
+			{
+				long dims = strtol(p, &end, 10);
+				if (end == p || dims < 1 || dims > INT_MAX)
+				{
+					fprintf(stderr, "malformed dimensions %s\n", optarg);
+					return 1;
+				}
+				options.dims.push_back((int) dims);
+			}
+			break;
+		case 'K':
+			options.checkpoint = optarg;
+			break;
+		case 'I':
+			if (!parse_double("--interval", optarg, 0, false, &options.interval))
+			{
+				return 1;
+			}
+			break;
+		case 'R':
+			options.resume = optarg;
+			break;
+		case 'G':
+			if (!parse_double("--gap", optarg, 0, false, &options.maxGap))
+			{
+				return 1;
+			}
+			break;
+		case 'S':
+			if (!parse_double("--max-seconds", optarg, 0, false, &options.maxSeconds))
+			{
+				return 1;
+			}
+			break;
+		case 'U':
+			if (!parse_long("--max-updates", optarg, 0, LONG_MAX, &number))
+			{
+				return 1;
+			}
+			options.maxUpdates = (unsigned long) number;
+			break;
+		case 'P':
+			options.progress = optarg;
+			break;
+		case 'i':
+			if (!parse_double("--progress-interval", optarg, 0, false, &options.progressInterval))
+			{
+				return 1;
+			}
+			break;
+		case 'Y':
+			if (strcmp(optarg, "label") != 0 && strcmp(optarg, "cluster") != 0)
+			{
+				fprintf(stderr, "unknown row order %s\n", optarg);
+				return 1;
+			}
+			options.order = (strcmp(optarg, "label") == 0) ? MySVM::ORDER_LABEL : MySVM::ORDER_CLUSTER;
+			break;
+		case 'N':
+			if (strcmp(optarg, "none") != 0 && strcmp(optarg, "compact") != 0 && strcmp(optarg, "spread") != 0)
+			{
+				fprintf(stderr, "unknown binding %s\n", optarg);
+				return 1;
+			}
+			options.binding = (strcmp(optarg, "compact") == 0) ? MySVM::BIND_COMPACT
+					: (strcmp(optarg, "spread") == 0) ? MySVM::BIND_SPREAD : MySVM::BIND_NONE;
+			break;
+		case 'H':
+			if (strcmp(optarg, "malloc") != 0 && strcmp(optarg, "thp") != 0 && strcmp(optarg, "hugetlb") != 0)
+			{
+				fprintf(stderr, "unknown page mode %s\n", optarg);
+				return 1;
+			}
+			options.pages = (strcmp(optarg, "thp") == 0) ? MySVM::PAGES_TRANSPARENT
+					: (strcmp(optarg, "hugetlb") == 0) ? MySVM::PAGES_HUGETLB : MySVM::PAGES_MALLOC;
+			break;
+		case 'Q':
+			if (strcmp(optarg, "int8") != 0 && strcmp(optarg, "none") != 0)
+			{
+				fprintf(stderr, "unknown quantization %s\n", optarg);
+				return 1;
+			}
+			options.quantize = strcmp(optarg, "int8") == 0;
+			break;
+		case 'f':
+			options.stream.follow = true;
+			break;
+		case 'r':
+			if (!parse_long("--report", optarg, 0, LONG_MAX, &number))
+			{
+				return 1;
+			}
+			options.stream.report = number;
+			break;
+		default:
+			usage(name);
+			return opt == 'h' ? 0 : 1;
 		}
+	}
 
-		kernel = (double)solver.y[i] * solver.alpha[i] * kernel - solver.b;
-		//sum = (double)solver.y[i] * (sum + solver.b);
-		printf("solver element: %d was = %f:%f\n",i,(double)solver.y[i],kernel);
-		kernel = 0;
+	int inputs = argc - optind;
+	if (strcmp(command, "train") == 0 && options.online)
+	{
+		options.stream.kernelType = options.kernelType;
+		options.stream.gamma = options.gamma;
+		options.stream.model_file = options.output;
+		if (!options.budgets.empty())
+		{
+			options.stream.budget = options.budgets[0];
+		}
+		if (options.batch > 0)
+		{
+			options.stream.batch = options.batch;
+		}
+		if (options.lambda > 0)
+		{
+			options.stream.lambda = options.lambda;
+		}
+		return MySVM::runOnline((inputs > 0) ? argv[optind] : "-", options.stream);
 	}
 
-}
+	int needed = (strcmp(command, "predict") == 0 || strcmp(command, "convert") == 0
+			|| strcmp(command, "reduce") == 0) ? 2 : 1;
+	if (inputs != needed)
+	{
+		usage(name);
+		return 1;
+	}
+
+	if (strcmp(command, "predict") == 0)
+	{
+		return predict(options, argv[optind], argv[optind + 1]);
+	}
+	if (strcmp(command, "convert") == 0)
+	{
+		return convert(options, argv[optind], argv[optind + 1]);
+	}
+	if (strcmp(command, "bench") == 0)
+	{
+		return bench(options, argv[optind]);
+	}
+	if (strcmp(command, "cv") == 0)
+	{
+		return cv(options, argv[optind]);
+	}
+	if (strcmp(command, "reduce") == 0)
+	{
+		return reduce(options, argv[optind], argv[optind + 1]);
+	}
+	return train(options, argv[optind]);
+} // main
@@ -0,0 +1,111 @@
+#include <thread_pool.h>
+#include <numa.h>
+
+namespace MySVM
+{
+
+ThreadPool::ThreadPool(int threads, const std::vector<int> &cpus) :
+	threads_(threads > 0 ? threads : 1), cpus_(cpus), callerPinned_(false), pinError_(0),
+	job_(NULL), generation_(0), pending_(0), stop_(false)
+{
+	if (!cpus_.empty())
+	{
+		callerPinned_ = sched_getaffinity(0, sizeof(callerAffinity_), &callerAffinity_) == 0;
+		pin(0);
+	}
+	for (int t = 1; t < threads_; t++)
+	{
+		workers_.push_back(std::thread(&ThreadPool::worker, this, t));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	start_.notify_all();
+	for (size_t t = 0; t < workers_.size(); t++)
+	{
+		workers_[t].join();
+	}
+	if (callerPinned_)
+	{
+		sched_setaffinity(0, sizeof(callerAffinity_), &callerAffinity_);
+	}
+}
+
+void ThreadPool::pin(int thread)
+{
+	if (cpus_.empty())
+	{
+		return;
+	}
+	int error = pin_thread(cpus_[thread % cpus_.size()]);
+	if (error != 0)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (pinError_ == 0)
+		{
+			pinError_ = error;
+		}
+	}
+}
+
+void ThreadPool::run(const Job &job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		job_ = &job;
+		pending_ = threads_ - 1;
+		++generation_;
+	}
+	start_.notify_all();
+
+	job(0, threads_);
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_.wait(lock, [this]() { return pending_ == 0; });
+	job_ = NULL;
+}
+
+void ThreadPool::worker(int thread)
+{
+	pin(thread);
+	unsigned long seen = 0;
+	for (;;)
+	{
+		const Job *job;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			start_.wait(lock, [this, seen]() { return stop_ || generation_ != seen; });
+			if (stop_)
+			{
+				return;
+			}
+			seen = generation_;
+			job = job_;
+		}
+
+		(*job)(thread, threads_);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (--pending_ == 0)
+		{
+			done_.notify_one();
+		}
+	}
+}
+
+void ThreadPool::range(long n, int thread, int threads, long *begin, long *end)
+{
+	long chunk = n / threads;
+	long extra = n % threads;
+	*begin = thread * chunk + (thread < extra ? thread : extra);
+	*end = *begin + chunk + (thread < extra ? 1 : 0);
+}
+
+}
+;
+// namespace
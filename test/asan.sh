@@ -0,0 +1,57 @@
+#! /bin/bash
+#
+# Runs the AddressSanitizer build over the training engines on src/test.input.
+# Each run must exit cleanly with no sanitizer report (leaks included) and,
+# unless its threads race by design (Hogwild sgd), reach the same accuracy as
+# the regular build.
+#
+# usage: test/asan.sh, after make svm_train asan (make test does both)
+
+set -e
+
+cd "$(dirname "$0")/.."
+
+out=$(mktemp /tmp/asan.XXXXXX)
+model=$(mktemp /tmp/asan_model.XXXXXX)
+trap 'rm -f "$out" "$model"' EXIT
+export ASAN_OPTIONS=detect_leaks=1:abort_on_error=0:exitcode=23
+
+status=0
+accuracy() {
+	grep -o -E "accuracy [0-9.]*%|[0-9.]*% progressive accuracy" | head -1
+}
+
+# runs model_asan with the arguments; fails on a non-zero exit or a sanitizer report
+clean() {
+	if ! ./model_asan "$@" > "$out" 2>&1 || grep -q "Sanitizer" "$out"; then
+		echo "FAIL: model_asan $*" >&2
+		grep -A 20 "Sanitizer" "$out" >&2 || tail -5 "$out" >&2
+		status=1
+		return 1
+	fi
+	echo "ok: $* ($(accuracy < "$out"))"
+}
+
+# clean(), and the accuracy must match the regular build
+check() {
+	clean "$@" || return 0
+	expected=$(./model "$@" 2> /dev/null | accuracy)
+	got=$(accuracy < "$out")
+	if [ "$expected" != "$got" ]; then
+		echo "FAIL: model_asan $*: $got, the regular build $expected" >&2
+		status=1
+	fi
+}
+
+check train src/test.input
+check train -e smo -l src/test.input
+check train -k rbf -o "$model" src/test.input
+check predict "$model" src/test.input
+check train -k rbf -t 2 src/test.input
+check train -k rbf -c 2 -t 2 src/test.input
+check train -k rbf -w 2 src/test.input
+check train -e sgd src/test.input
+clean train -e sgd -t 2 src/test.input
+check train -k rbf -A rff -D 100 src/test.input
+clean train -O -k rbf -B 50 -r 0 src/test.input
+exit $status
@@ -0,0 +1,26 @@
+#! /bin/bash
+#
+# A budgeted online RBF model must beat predicting the majority class on the
+# data it was trained on; pruning the support vectors of one class, or a
+# threshold that swamps the kernel expansion, both end up at the majority.
+#
+# usage: test/online_budget.sh, after make svm_train svm_gen (make test does both)
+
+set -e
+
+cd "$(dirname "$0")/.."
+
+data=$(mktemp /tmp/online_budget.XXXXXX)
+model=$(mktemp /tmp/online_budget_model.XXXXXX)
+trap 'rm -f "$data" "$model"' EXIT
+./svm_gen -n 3000 -m 20 -e 0.05 -s 0.3 -S 7 "$data"
+
+./model train -O -k rbf -B 100 -r 0 -o "$model" "$data" > /dev/null
+accuracy=$(./model predict "$model" "$data" | sed -n -e 's/^predict: accuracy \([0-9.]*\)%.*/\1/p')
+majority=$(awk '{ n[$1]++ } END { m = 0; for (y in n) if (n[y] > m) m = n[y]; print 100 * m / NR }' "$data")
+
+echo "online budget 100: accuracy ${accuracy}%, majority class ${majority}%"
+if ! awk -v a="$accuracy" -v m="$majority" 'BEGIN { exit !(a > m + 10) }'; then
+	echo "FAIL: the budgeted model does not beat the majority class by 10 points" >&2
+	exit 1
+fi
@@ -1,3 +1,18 @@
 #! /bin/bash
+#
+# Builds the trainer if needed and runs one of its commands.
+#
+# usage: ./train.sh train|predict|convert|bench|cv [options] files...
+#   e.g. ./train.sh train -k rbf -o model.txt src/test.input
+#        ./train.sh predict -o predictions.txt model.txt src/test.input
+#   ./train.sh -h lists the options
 
-echo "To run enter arguments a b c"
+set -e
+
+cd "$(dirname "$0")"
+make svm_train > /dev/null
+
+if [ $# -eq 0 ]; then
+	exec ./model -h
+fi
+exec ./model "$@"